@@ -0,0 +1,349 @@
+//
+//  GJK_batch.h
+//  Naive2D
+//
+//  GJK intersection and distance for many independent pairs of small convex
+//  polygons at once. One GJK query is a chain of short dependent steps, so
+//  instead of vectorizing inside a query, W queries run side by side, one
+//  per SIMD lane: the vertices of W polygons are stored transposed (vertex v
+//  of every lane in one vector) and every step of the iteration works on
+//  vectors of W doubles (GCC/Clang vector extensions; every branch of the
+//  scalar code becomes a per lane select). Lanes that have finished are
+//  masked off until the whole batch is done. The steps are the same
+//  expressions as in GJK::intersects_support and GJK::distance_support, so
+//  every lane gives the result of the scalar functions. W = 1, the default
+//  on targets without a vector unit, calls the scalar functions directly.
+//
+
+#ifndef Naive2D_GJK_batch_h
+#define Naive2D_GJK_batch_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "GJK_utility.h"
+
+namespace N2D {
+    namespace GJK
+    {
+        // lanes of one batch: a vector register of doubles. Wider batches than the register are split
+        // into several and the per lane selects fall apart, which is several times slower than W = 1.
+#if defined(__AVX512F__)
+        constexpr unsigned BATCH_LANES = 8;
+#elif defined(__AVX__)
+        constexpr unsigned BATCH_LANES = 4;
+#elif defined(__SSE2__) || defined(__aarch64__) || defined(__VSX__)
+        constexpr unsigned BATCH_LANES = 2;
+#else
+        constexpr unsigned BATCH_LANES = 1;
+#endif
+        // larger polygons are handed to the scalar functions
+        constexpr unsigned BATCH_MAX_VERTICES = 16;
+
+        namespace batch_detail
+        {
+            // W doubles in one vector register, and the masks comparing them gives (all bits set in true lanes)
+            template <unsigned W>
+            struct Lanes
+            {
+                typedef double type __attribute__((vector_size(W * sizeof(double))));
+                typedef int64_t mask __attribute__((vector_size(W * sizeof(int64_t))));
+            };
+
+            /* Lanes are only ever passed by reference: a vector wider than the enabled instruction set
+             * has no stable calling convention (GCC warns with -Wpsabi) and would go through memory.
+             */
+            template <class T>
+            static inline void splat( double value, T& lanes )
+            {
+                for( unsigned l = 0; l < sizeof(T) / sizeof(double); l++ ) lanes[l] = value;
+            }
+
+            template <unsigned W>
+            static inline bool any( const typename Lanes<W>::mask& mask )
+            {
+                int64_t any = 0;
+                for( unsigned l = 0; l < W; l++ ) any |= mask[l];
+                return any != 0;
+            }
+
+            // GJK::closest_to_origin; the v2 operations and std::min / std::max are written out in the same order
+            template <unsigned W, class T = typename Lanes<W>::type>
+            static inline void closest_to_origin( const T& ax, const T& ay, const T& bx, const T& by, T& x, T& y )
+            {
+                T abx = bx - ax, aby = by - ay;
+                T t = -(ax * abx + ay * aby) / (abx * abx + aby * aby);
+                t = 1.0 < t ? 1.0 : t;
+                t = 0.0 < t ? t : 0.0;
+                x = abx * t + ax;
+                y = aby * t + ay;
+            }
+        }
+
+        // W polygons, transposed. Shorter polygons repeat their last vertex, which does not change any support point.
+        template <unsigned W>
+        struct Lane_polygons
+        {
+            typedef typename batch_detail::Lanes<W>::type Row;
+
+            Row x[BATCH_MAX_VERTICES];
+            Row y[BATCH_MAX_VERTICES];
+            unsigned vertices = 0;      // the most any lane has
+
+            /* Loads polygons[0 .. lanes) into the lanes, a row at a time; the lanes from `lanes` on
+             * repeat polygon 0 and are ignored.
+             */
+            void load( const Polygon_view* const* polygons, unsigned lanes )
+            {
+                vertices = 0;
+                for( unsigned l = 0; l < lanes; l++ ) vertices = std::max(vertices, polygons[l]->size);
+                for( unsigned v = 0; v < vertices; v++ )
+                {
+                    Row row_x, row_y;
+                    for( unsigned l = 0; l < W; l++ )
+                    {
+                        const Polygon_view& polygon = *polygons[l < lanes ? l : 0];
+                        const v2& p = polygon[std::min(v, polygon.size - 1)];
+                        row_x[l] = p.x;
+                        row_y[l] = p.y;
+                    }
+                    x[v] = row_x;
+                    y[v] = row_y;
+                }
+            }
+
+            // The farthest vertex of every lane in direction (dx, dy); the first one on ties, as farest_point_in_dir.
+            void farthest( const Row& dx, const Row& dy, Row& px, Row& py ) const
+            {
+                Row best = x[0] * dx + y[0] * dy;
+                px = x[0];
+                py = y[0];
+                for( unsigned v = 1; v < vertices; v++ )
+                {
+                    Row dot = x[v] * dx + y[v] * dy;
+                    typename batch_detail::Lanes<W>::mask better = dot > best;
+                    best = better ? dot : best;
+                    px = better ? x[v] : px;
+                    py = better ? y[v] : py;
+                }
+            }
+        };
+
+        namespace batch_detail
+        {
+            // support of the Minkowski difference a - b in direction (dx, dy), as support_func
+            template <unsigned W, class T = typename Lanes<W>::type>
+            static inline void support( const Lane_polygons<W>& a, const Lane_polygons<W>& b, const T& dx, const T& dy, T& px, T& py )
+            {
+                T ax, ay, bx, by;
+                a.farthest(dx, dy, ax, ay);
+                b.farthest(-dx, -dy, bx, by);
+                px = ax - bx;
+                py = ay - by;
+            }
+        }
+
+        // GJK::intersects on the first `lanes` lanes of a and b
+        template <unsigned W>
+        static inline void intersects_lanes( const Lane_polygons<W>& a, const Lane_polygons<W>& b, unsigned lanes, bool* results )
+        {
+            using namespace batch_detail;
+            typedef typename Lanes<W>::type T;
+            typedef typename Lanes<W>::mask M;
+            // simplex[0] = support(-dir) with dir = (1, -1)
+            T s0x, s0y, s1x = {}, s1y = {}, s2x = {}, s2y = {};
+            T dx, dy;
+            splat(1.0, dx);
+            splat(-1.0, dy);
+            support<W>(a, b, -dx, -dy, s0x, s0y);
+            M active, hit = M{} != M{}, triangle = hit;
+            for( unsigned l = 0; l < W; l++ ) active[l] = l < lanes ? -1 : 0;
+
+            while( any<W>(active) )
+            {
+                T x, y;
+                support<W>(a, b, dx, dy, x, y);
+                // the new point is the second or the third of the simplex
+                T ax = s0x, ay = s0y;
+                T bx = triangle ? s1x : x, by = triangle ? s1y : y;
+                T cx = triangle ? x : s2x, cy = triangle ? y : s2y;
+                // the point added last did not pass the origin
+                M passed = ~(x * dx + y * dy <= 0.0);
+
+                // triangle: drop the vertex opposite to the edge the origin is beyond
+                T x1 = -(by - cy), y1 = bx - cx;
+                M flip1 = ax * x1 + ay * y1 > 0.0;
+                x1 = flip1 ? -x1 : x1;
+                y1 = flip1 ? -y1 : y1;
+                M drop0 = cx * x1 + cy * y1 < 0.0;
+                T x2 = -(ay - cy), y2 = ax - cx;
+                M flip2 = bx * x2 + by * y2 > 0.0;
+                x2 = flip2 ? -x2 : x2;
+                y2 = flip2 ? -y2 : y2;
+                M drop1 = cx * x2 + cy * y2 < 0.0;
+                // segment: towards the origin
+                T x3 = -(ay - by), y3 = ax - bx;
+                M flip3 = bx * x3 + by * y3 > 0.0;
+                x3 = flip3 ? -x3 : x3;
+                y3 = flip3 ? -y3 : y3;
+
+                M inside = passed & triangle & ~drop0 & ~drop1;
+                s0x = triangle & drop0 ? cx : ax;
+                s0y = triangle & drop0 ? cy : ay;
+                s1x = triangle & ~drop0 ? cx : bx;
+                s1y = triangle & ~drop0 ? cy : by;
+                s2x = cx;
+                s2y = cy;
+                dx = triangle ? (drop0 ? x1 : x2) : x3;
+                dy = triangle ? (drop0 ? y1 : y2) : y3;
+                // from now on every live lane has two points and adds the third
+                triangle = M{} == M{};
+                hit = active ? inside : hit;
+                active = active & passed & ~inside;
+            }
+            for( unsigned l = 0; l < lanes; l++ ) results[l] = hit[l] != 0;
+        }
+
+        // GJK::distance on the first `lanes` lanes of a and b
+        template <unsigned W>
+        static inline void distance_lanes( const Lane_polygons<W>& a, const Lane_polygons<W>& b, unsigned lanes, double* results )
+        {
+            using namespace batch_detail;
+            typedef typename Lanes<W>::type T;
+            typedef typename Lanes<W>::mask M;
+            T ax, ay, bx, by, dx, dy, one;
+            splat(1.0, one);
+            support<W>(a, b, one, -one, ax, ay);
+            support<W>(a, b, -one, one, bx, by);
+            closest_to_origin<W>(ax, ay, bx, by, dx, dy);
+            dx = -dx;
+            dy = -dy;
+            // the square of the distance of the lanes that converged, 0 for the others
+            T squared = {};
+            M active = ~(dx * dx + dy * dy <= EPSILON);
+            for( unsigned l = lanes; l < W; l++ ) active[l] = 0;
+
+            while( any<W>(active) )
+            {
+                T cx, cy;
+                support<W>(a, b, dx, dy, cx, cy);
+                T sa = ax * by - ay * bx;
+                T da = ax * dx + ay * dy;
+                T db = bx * dx + by * dy;
+                T sb = bx * cy - by * cx;
+                T sc = cx * ay - cy * ax;
+                T dc = cx * dx + cy * dy;
+                // the origin is in the triangle abc
+                T sab = sa * sb, sac = sa * sc;
+                M inside = (sac < sab ? sac : sab) > 0.0;
+                // no progress: c is the closest point to the origin
+                T progress_a = dc - da, progress_b = dc - db;
+                M converged = ~inside & ((progress_b < progress_a ? progress_b : progress_a) <= EPSILON);
+
+                T p1x, p1y, p2x, p2y;
+                closest_to_origin<W>(ax, ay, cx, cy, p1x, p1y);
+                closest_to_origin<W>(bx, by, cx, cy, p2x, p2y);
+                T p1_mag = p1x * p1x + p1y * p1y;
+                T p2_mag = p2x * p2x + p2y * p2y;
+                M touching = (p2_mag < p1_mag ? p2_mag : p1_mag) <= EPSILON;
+                M step = active & ~inside & ~converged & ~touching;
+                M keep_a = p1_mag <= p2_mag;
+
+                squared = active & converged ? -dc : squared;
+                ax = step & ~keep_a ? cx : ax;
+                ay = step & ~keep_a ? cy : ay;
+                bx = step & keep_a ? cx : bx;
+                by = step & keep_a ? cy : by;
+                dx = keep_a ? -p1x : -p2x;
+                dy = keep_a ? -p1y : -p2y;
+                active = step;
+            }
+            for( unsigned l = 0; l < lanes; l++ ) results[l] = std::sqrt(squared[l]);
+        }
+
+        /* results[i] = GJK::intersects(first[i], second[i]) for count pairs of convex polygons,
+         * W pairs at a time. W = 1 is a plain loop over GJK::intersects.
+         */
+        template <unsigned W = BATCH_LANES>
+        static inline void intersects_batch( const Polygon_view* first, const Polygon_view* second, size_t count, bool* results )
+        {
+            if( W == 1 )
+            {
+                for( size_t i = 0; i < count; i++ )
+                    results[i] = GJK::intersects(first[i].vertices, first[i].size, second[i].vertices, second[i].size);
+                return;
+            }
+            Lane_polygons<W> a, b;
+            const Polygon_view* firsts[W];
+            const Polygon_view* seconds[W];
+            size_t index[W];
+            bool hits[W];
+            unsigned lanes = 0;
+            auto flush = [&](){
+                a.load(firsts, lanes);
+                b.load(seconds, lanes);
+                intersects_lanes<W>(a, b, lanes, hits);
+                for( unsigned l = 0; l < lanes; l++ ) results[index[l]] = hits[l];
+                lanes = 0;
+            };
+            for( size_t i = 0; i < count; i++ )
+            {
+                if( first[i].size > BATCH_MAX_VERTICES || second[i].size > BATCH_MAX_VERTICES )
+                {
+                    results[i] = GJK::intersects(first[i].vertices, first[i].size, second[i].vertices, second[i].size);
+                    continue;
+                }
+                firsts[lanes] = first + i;
+                seconds[lanes] = second + i;
+                index[lanes++] = i;
+                if( lanes == W ) flush();
+            }
+            if( lanes > 0 ) flush();
+        }
+
+        // results[i] = GJK::distance(first[i], second[i]), W pairs at a time; W = 1 is a plain loop over GJK::distance.
+        template <unsigned W = BATCH_LANES>
+        static inline void distance_batch( const Polygon_view* first, const Polygon_view* second, size_t count, double* results )
+        {
+            if( W == 1 )
+            {
+                for( size_t i = 0; i < count; i++ )
+                    results[i] = GJK::distance(first[i].vertices, first[i].size, second[i].vertices, second[i].size);
+                return;
+            }
+            Lane_polygons<W> a, b;
+            const Polygon_view* firsts[W];
+            const Polygon_view* seconds[W];
+            size_t index[W];
+            double distances[W];
+            unsigned lanes = 0;
+            auto flush = [&](){
+                a.load(firsts, lanes);
+                b.load(seconds, lanes);
+                distance_lanes<W>(a, b, lanes, distances);
+                for( unsigned l = 0; l < lanes; l++ ) results[index[l]] = distances[l];
+                lanes = 0;
+            };
+            for( size_t i = 0; i < count; i++ )
+            {
+                if( first[i].size > BATCH_MAX_VERTICES || second[i].size > BATCH_MAX_VERTICES )
+                {
+                    results[i] = GJK::distance(first[i].vertices, first[i].size, second[i].vertices, second[i].size);
+                    continue;
+                }
+                firsts[lanes] = first + i;
+                seconds[lanes] = second + i;
+                index[lanes++] = i;
+                if( lanes == W ) flush();
+            }
+            if( lanes > 0 ) flush();
+        }
+
+    }
+}
+
+#endif
@@ -15,10 +15,13 @@
 #ifndef GJK_GJK_utility_h
 #define GJK_GJK_utility_h
 #include "geometry.h"
+#include "trace.h"
 #include <iostream>
 #include <cmath>
 #include <limits>
 #include <vector>
+#include <array>
+#include <utility>
 using namespace std;
 
 namespace N2D {
@@ -47,9 +50,9 @@ namespace N2D {
             return results;
         }
         
-        static inline v2 farest_point_in_dir( const std::vector<v2>& points, const v2& dir )
+        static inline v2 farest_point_in_dir( const v2* points, unsigned n, const v2& dir )
         {
-            int size = (unsigned)points.size();
+            int size = (int)n;
             int index = 0;
             double max_dot = points[0].dot(dir);
             double dot = points[1].dot(dir);
@@ -65,6 +68,36 @@ namespace N2D {
             return points[dot > max_dot ? size - 1 : index];
         }
         
+        static inline v2 farest_point_in_dir( const std::vector<v2>& points, const v2& dir )
+        {
+            return farest_point_in_dir(points.data(), (unsigned)points.size(), dir);
+        }
+        
+        template <size_t N, size_t... I>
+        static inline v2 farest_point_in_dir( const std::array<v2, N>& points, const v2& dir, std::index_sequence<I...> )
+        {
+            size_t index = 0;
+            double max_dot = points[0].dot(dir);
+            auto visit = [&](size_t i) {
+                double dot = points[i].dot(dir);
+                if (dot > max_dot) { max_dot = dot; index = i; }
+            };
+            (visit(I + 1), ...);
+            return points[index];
+        }
+        
+        // Fully unrolled for polygons whose size is known at compile time.
+        template <size_t N>
+        static inline v2 farest_point_in_dir( const std::array<v2, N>& points, const v2& dir )
+        {
+            return farest_point_in_dir(points, dir, std::make_index_sequence<N - 1>());
+        }
+        
+        static inline v2 support_func( const v2* poly_points1, unsigned n1, const v2* poly_points2, unsigned n2, const v2& dir )
+        {
+            return farest_point_in_dir(poly_points1, n1, dir) - farest_point_in_dir(poly_points2, n2, -dir);
+        }
+        
         static inline v2 support_func( const std::vector<v2>& poly_points1, const std::vector<v2>& poly_points2, const v2& dir )
         {
             return farest_point_in_dir(poly_points1, dir) - farest_point_in_dir(poly_points2, -dir);
@@ -142,15 +175,23 @@ namespace N2D {
         }
 
         
-        static bool intersects( const std::vector<v2>& poly1, const std::vector<v2>& poly2 )
+        /* GJK on any convex shape given by its support function.
+         * @param support: callable, support(dir) returns the point of the Minkowski difference
+         *                 (shape1 - shape2) farthest in direction dir.
+         * This lets implicit shapes (e.g. a polygon swept along a segment) be tested without
+         * building their vertices.
+         */
+        template <class Support>
+        static bool intersects_support( const Support& support )
         {
+            N2D_TRACE_SPAN("GJK::intersects");
             v2 simplex[3];
             v2 dir{1, -1};
             int count = 0;
-            simplex[count++] = support_func(poly1, poly2, -dir);
+            simplex[count++] = support(-dir);
             
             while (true) {
-                simplex[count++] = support_func(poly1, poly2, dir);
+                simplex[count++] = support(dir);
                 // make sure that the last point we added actually passed the origin
                 if (simplex[count-1].dot(dir) <= 0.0)
                 {
@@ -167,16 +208,37 @@ namespace N2D {
             }
         }
         
-        static inline double distance( const std::vector<v2>& poly1, const std::vector<v2>& poly2 )
+        // Works on raw vertex arrays so that polygons which do not own their vertices
+        // (e.g. views into a memory mapped scene) can be tested without copying.
+        static bool intersects( const v2* poly1, unsigned n1, const v2* poly2, unsigned n2 )
+        {
+            return intersects_support([=](const v2& dir){ return support_func(poly1, n1, poly2, n2, dir); });
+        }
+        
+        template <size_t N, size_t M>
+        static inline bool intersects( const std::array<v2, N>& poly1, const std::array<v2, M>& poly2 )
+        {
+            return intersects_support([&](const v2& dir){ return farest_point_in_dir(poly1, dir) - farest_point_in_dir(poly2, -dir); });
+        }
+        
+        static bool intersects( const std::vector<v2>& poly1, const std::vector<v2>& poly2 )
         {
+            return intersects(poly1.data(), (unsigned)poly1.size(), poly2.data(), (unsigned)poly2.size());
+        }
+        
+        // Distance between two convex shapes given by the support function of their Minkowski difference.
+        template <class Support>
+        static inline double distance_support( const Support& support )
+        {
+            N2D_TRACE_SPAN("GJK::distance");
             v2 dir{1, -1};
-            v2 a{support_func(poly1, poly2, dir)};
-            v2 b{support_func(poly1, poly2, -dir)};
+            v2 a{support(dir)};
+            v2 b{support(-dir)};
             dir = -closest_to_origin(a, b);
             if ( dir.rsq() <= EPSILON )
                 return 0.0;
             while (true) {
-                v2 c{support_func(poly1, poly2, dir)};
+                v2 c{support(dir)};
                 double sa = a.cross(b);
                 double da = a.dot(dir);
                 double db = b.dot(dir);
@@ -206,7 +268,92 @@ namespace N2D {
                     dir = -p2;
                 }
             }
-        }       
+        }
+        
+        static inline double distance( const v2* poly1, unsigned n1, const v2* poly2, unsigned n2 )
+        {
+            return distance_support([=](const v2& dir){ return support_func(poly1, n1, poly2, n2, dir); });
+        }
+        
+        template <size_t N, size_t M>
+        static inline double distance( const std::array<v2, N>& poly1, const std::array<v2, M>& poly2 )
+        {
+            return distance_support([&](const v2& dir){ return farest_point_in_dir(poly1, dir) - farest_point_in_dir(poly2, -dir); });
+        }
+        
+        static inline double distance( const std::vector<v2>& poly1, const std::vector<v2>& poly2 )
+        {
+            return distance(poly1.data(), (unsigned)poly1.size(), poly2.data(), (unsigned)poly2.size());
+        }
+
+        /* Same iteration as distance_support, but every simplex point remembers the two polygon
+         * points it came from, so the closest points of the polygons come out too.
+         * Returns 0 and leaves point1, point2 untouched if the polygons overlap.
+         */
+        static inline double closest_points( const v2* poly1, unsigned n1, const v2* poly2, unsigned n2, v2& point1, v2& point2 )
+        {
+            N2D_TRACE_SPAN("GJK::closest_points");
+            struct Vertex { v2 w, p1, p2; };    // w = p1 - p2
+            auto support = [&](const v2& dir) {
+                Vertex v;
+                v.p1 = farest_point_in_dir(poly1, n1, dir);
+                v.p2 = farest_point_in_dir(poly2, n2, -dir);
+                v.w = v.p1 - v.p2;
+                return v;
+            };
+            auto closest = [](const Vertex& a, const Vertex& b) {
+                v2 ab(b.w - a.w);
+                double len = ab.rsq();
+                double t = len > 0.0 ? std::max(0.0, std::min(-a.w.dot(ab) / len, 1.0)) : 0.0;
+                Vertex v;
+                v.w = a.w + ab * t;
+                v.p1 = a.p1 + (b.p1 - a.p1) * t;
+                v.p2 = a.p2 + (b.p2 - a.p2) * t;
+                return v;
+            };
+
+            v2 dir{1, -1};
+            Vertex a{support(dir)};
+            Vertex b{support(-dir)};
+            Vertex p{closest(a, b)};
+            dir = -p.w;
+            if ( dir.rsq() <= EPSILON )
+                return 0.0;
+            while (true) {
+                Vertex c{support(dir)};
+                double sa = a.w.cross(b.w);
+                double sb = b.w.cross(c.w);
+                double sc = c.w.cross(a.w);
+                if (std::min(sa * sb, sa * sc) > 0.0)
+                    return 0.0;
+
+                double da = a.w.dot(dir);
+                double db = b.w.dot(dir);
+                double dc = c.w.dot(dir);
+                if (std::min(dc - da, dc - db) <= EPSILON)
+                {
+                    point1 = p.p1;
+                    point2 = p.p2;
+                    return p.w.r();
+                }
+
+                Vertex p1{closest(a, c)};
+                Vertex p2{closest(b, c)};
+                double p1_mag = p1.w.rsq();
+                double p2_mag = p2.w.rsq();
+                if (std::min(p1_mag, p2_mag) <= EPSILON)
+                    return 0.0;
+
+                if (p1_mag <= p2_mag) {
+                    b = c;
+                    p = p1;
+                } else {
+                    a = c;
+                    p = p2;
+                }
+                dir = -p.w;
+            }
+        }
     }
 }
 
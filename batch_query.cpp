@@ -0,0 +1,783 @@
+//
+//  batch_query.cpp
+//  Naive2D
+//
+//  A command line tool that evaluates a stream of queries against a scene
+//  file, for offline jobs that would otherwise need their own C++ program.
+//
+//      batch_query [options] scene.n2ds [queries]     (queries from stdin if omitted or -)
+//      batch_query import scene.txt scene.n2ds        (text scene, see scene_file.h)
+//      batch_query generate scene.n2ds count [seed]   (random queries over the scene)
+//
+//  Options:
+//      --robot "x1 y1 x2 y2 ..."   convex footprint for pose queries, in its own frame
+//      --binary                    binary queries in, binary results out
+//      --threads n                 evaluating threads (default: hardware threads)
+//      --output path               results to a file instead of stdout
+//      --stats                     throughput on stderr
+//
+//  Text queries, one per line (blank lines and # comments give no result):
+//      p x y           1 if the point is inside an obstacle, else 0
+//      c x y theta     1 if the robot at the pose overlaps an obstacle, else 0
+//      d x y theta     distance from the robot at the pose to the nearest obstacle (inf if none)
+//  The robot is rotated by theta around its origin and then moved to (x, y).
+//  Binary queries are Query_record below, binary results one double each
+//  (inf for a distance with no obstacle). If a query is malformed, the
+//  results of every query before it are still written, then the tool fails.
+//
+//  The queries go through three stages in constant memory: one thread reads
+//  blocks of whole lines (or records), a pool of threads parses and
+//  evaluates them, one thread writes the results back in input order. A
+//  fixed pool of blocks circulates between the stages, so a slow writer
+//  stalls the reader instead of buffering the input. Obstacles are found
+//  through a uniform grid over their bounding boxes.
+//
+//  Build:
+//      g++ -std=c++17 -fopenmp -O3 -march=native -pthread batch_query.cpp -o batch_query
+//
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "scene_file.h"
+#include "scene_generator.h"
+#include "raycast.h"
+
+using namespace N2D;
+
+enum class QUERY : uint32_t { POINT = 0, COLLIDE = 1, DISTANCE = 2 };
+
+// one binary query
+struct Query_record
+{
+    uint32_t kind;      // QUERY
+    uint32_t reserved;
+    double x, y, theta;
+};
+static_assert(sizeof(Query_record) == 32, "records must be packed");
+
+/* The obstacles of a scene file in a uniform grid of their bounding boxes. Polygons stay views into the
+ * mapped file; convex ones are tested with GJK, the others edge by edge. L1 and L-infinity spheres become
+ * polygons, L2 spheres are tested analytically.
+ */
+class Scene_index
+{
+public:
+    explicit Scene_index( const Scene_file& scene )
+    {
+        for( uint64_t i = 0; i < scene.polygon_count(); i++ )
+        {
+            Polygon_view polygon = scene.polygon(i);
+            shapes.push_back(Shape{convex(polygon) ? Shape::CONVEX : Shape::CONCAVE, polygon, sphere(), scene.bounds(i)});
+        }
+        // the corners are stored first, so the views into them stay valid
+        corners.reserve(4 * scene.sphere_count());
+        for( uint64_t i = 0; i < scene.sphere_count(); i++ )
+        {
+            sphere s = scene.get_sphere(i);
+            if( s.metric == SPHEREMETRIC::L2 )
+            {
+                v2 r(s.radius(), s.radius());
+                shapes.push_back(Shape{Shape::DISC, Polygon_view(nullptr, 0), s, AABB(s.center() - r, s.center() + r)});
+                continue;
+            }
+            for( const v2& corner : cast_detail::corners(s) ) corners.push_back(corner);
+            Polygon_view polygon(corners.data() + corners.size() - 4, 4);
+            shapes.push_back(Shape{Shape::CONVEX, polygon, s, polygon.bounds()});
+        }
+        build_grid();
+    }
+
+    size_t size() const { return shapes.size(); }
+
+    // Per thread scratch space, so that queries take no lock.
+    struct Scratch
+    {
+        std::vector<uint32_t> stamps;
+        uint32_t stamp = 0;
+        std::vector<v2> footprint;
+    };
+
+    void prepare( Scratch& scratch ) const { scratch.stamps.assign(shapes.size(), 0); }
+
+    bool contains( const v2& point ) const
+    {
+        if( shapes.empty() || !inside_grid(point) ) return false;
+        uint32_t c = cell_y(point.y) * columns + cell_x(point.x);
+        for( uint32_t k = cell_start[c]; k < cell_start[c + 1]; k++ )
+        {
+            const Shape& shape = shapes[cell_items[k]];
+            if( point.x < shape.box.min.x || point.x > shape.box.max.x || point.y < shape.box.min.y || point.y > shape.box.max.y )
+                continue;
+            if( shape.kind == Shape::DISC ? shape.disc.contains(point) : shape.polygon.contains(point) )
+                return true;
+        }
+        return false;
+    }
+
+    bool intersects( const Polygon_view& footprint, Scratch& scratch ) const
+    {
+        if( shapes.empty() ) return false;
+        AABB box = footprint.bounds();
+        if( box.max.x < bounds.min.x || box.min.x > bounds.max.x || box.max.y < bounds.min.y || box.min.y > bounds.max.y )
+            return false;
+        next_stamp(scratch);
+        for( uint32_t y = cell_y(box.min.y); y <= cell_y(box.max.y); y++ )
+            for( uint32_t x = cell_x(box.min.x); x <= cell_x(box.max.x); x++ )
+            {
+                uint32_t c = y * columns + x;
+                for( uint32_t k = cell_start[c]; k < cell_start[c + 1]; k++ )
+                {
+                    uint32_t id = cell_items[k];
+                    if( scratch.stamps[id] == scratch.stamp ) continue;
+                    scratch.stamps[id] = scratch.stamp;
+                    if( shapes[id].box.overlaps(box) && overlaps(shapes[id], footprint) ) return true;
+                }
+            }
+        return false;
+    }
+
+    /* Visits rings of cells around the footprint until no obstacle outside the visited cells
+     * can be nearer than the best one so far.
+     */
+    double distance_to( const Polygon_view& footprint, Scratch& scratch ) const
+    {
+        double best = MAX_DOUBLE;
+        if( shapes.empty() ) return best;
+        AABB box = footprint.bounds();
+        next_stamp(scratch);
+        int x0 = cell_x(box.min.x), x1 = cell_x(box.max.x), y0 = cell_y(box.min.y), y1 = cell_y(box.max.y);
+        for( int ring = 0; ; ring++ )
+        {
+            int rx0 = x0 - ring, rx1 = x1 + ring, ry0 = y0 - ring, ry1 = y1 + ring;
+            for( int y = std::max(ry0, 0); y <= std::min(ry1, (int)rows - 1); y++ )
+            {
+                bool edge_row = y == ry0 || y == ry1;
+                for( int x = std::max(rx0, 0); x <= std::min(rx1, (int)columns - 1); x++ )
+                {
+                    if( !edge_row && x > rx0 && x < rx1 ){ x = rx1 - 1; continue; }
+                    uint32_t c = y * columns + x;
+                    for( uint32_t k = cell_start[c]; k < cell_start[c + 1]; k++ )
+                    {
+                        uint32_t id = cell_items[k];
+                        if( scratch.stamps[id] == scratch.stamp ) continue;
+                        scratch.stamps[id] = scratch.stamp;
+                        if( box_distance(shapes[id].box, box) >= best ) continue;
+                        best = std::min(best, distance(shapes[id], footprint));
+                        if( best == 0.0 ) return 0.0;
+                    }
+                }
+            }
+            // every obstacle not visited yet lies beyond one side of the visited cells
+            double bound = MAX_DOUBLE;
+            if( rx0 > 0 )                bound = std::min(bound, box.min.x - (bounds.min.x + rx0 * cell));
+            if( rx1 < (int)columns - 1 ) bound = std::min(bound, bounds.min.x + (rx1 + 1) * cell - box.max.x);
+            if( ry0 > 0 )                bound = std::min(bound, box.min.y - (bounds.min.y + ry0 * cell));
+            if( ry1 < (int)rows - 1 )    bound = std::min(bound, bounds.min.y + (ry1 + 1) * cell - box.max.y);
+            if( bound >= best ) return best;
+        }
+    }
+
+private:
+    struct Shape
+    {
+        enum KIND { CONVEX, CONCAVE, DISC } kind;
+        Polygon_view polygon;
+        sphere disc;
+        AABB box;
+    };
+
+    std::vector<Shape> shapes;
+    std::vector<v2> corners;
+    AABB bounds;
+    double cell = 1.0;
+    uint32_t columns = 0, rows = 0;
+    std::vector<uint32_t> cell_start, cell_items;
+
+    static bool convex( const Polygon_view& polygon )
+    {
+        double sign = 0.0;
+        for( unsigned i = 0; i < polygon.size; i++ )
+        {
+            const v2& a = polygon[i];
+            const v2& b = polygon[(i + 1) % polygon.size];
+            const v2& c = polygon[(i + 2) % polygon.size];
+            double o = predicates::orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+            if( o == 0.0 ) continue;
+            if( sign * o < 0.0 ) return false;
+            sign = o;
+        }
+        return true;
+    }
+
+    static double box_distance( const AABB& a, const AABB& b )
+    {
+        double dx = std::max(0.0, std::max(a.min.x - b.max.x, b.min.x - a.max.x));
+        double dy = std::max(0.0, std::max(a.min.y - b.max.y, b.min.y - a.max.y));
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    static bool overlaps( const Shape& shape, const Polygon_view& footprint )
+    {
+        switch( shape.kind )
+        {
+            case Shape::CONVEX:  return footprint.intersects(shape.polygon);
+            case Shape::CONCAVE: return footprint.naive_intersects(shape.polygon);
+            default:             return footprint.contains(shape.disc.center()) || footprint.distance_to(shape.disc.center()) <= shape.disc.radius();
+        }
+    }
+
+    static double distance( const Shape& shape, const Polygon_view& footprint )
+    {
+        switch( shape.kind )
+        {
+            case Shape::CONVEX:  return footprint.distance_to(shape.polygon);
+            case Shape::CONCAVE: return footprint.naive_distance_to(shape.polygon);
+            default:             return std::max(0.0, footprint.distance_to(shape.disc.center()) - shape.disc.radius());
+        }
+    }
+
+    // about one obstacle per cell, but no smaller than an average obstacle
+    void build_grid()
+    {
+        if( shapes.empty() ) return;
+        double extent = 0.0;
+        for( const Shape& shape : shapes )
+        {
+            bounds.expand(shape.box.min);
+            bounds.expand(shape.box.max);
+            extent += std::max(shape.box.max.x - shape.box.min.x, shape.box.max.y - shape.box.min.y);
+        }
+        double width = std::max(bounds.max.x - bounds.min.x, 1e-9), height = std::max(bounds.max.y - bounds.min.y, 1e-9);
+        cell = std::max(std::sqrt(width * height / shapes.size()), extent / shapes.size());
+        cell = std::max(cell, std::max(width, height) / 4096);
+        columns = (uint32_t)std::ceil(width / cell) + 1;
+        rows = (uint32_t)std::ceil(height / cell) + 1;
+
+        // neighbours in space become neighbours in memory
+        auto home = [&]( const Shape& shape ){
+            v2 center = (shape.box.min + shape.box.max) * 0.5;
+            return (uint64_t)cell_y(center.y) * columns + cell_x(center.x);
+        };
+        std::sort(shapes.begin(), shapes.end(), [&]( const Shape& a, const Shape& b ){ return home(a) < home(b); });
+
+        // counting sort of the obstacles into the cells they overlap
+        cell_start.assign((size_t)columns * rows + 1, 0);
+        for( int pass = 0; pass < 2; pass++ )
+        {
+            if( pass == 1 )
+            {
+                for( size_t c = 1; c < cell_start.size(); c++ ) cell_start[c] += cell_start[c - 1];
+                cell_items.resize(cell_start.back());
+            }
+            for( uint32_t id = 0; id < shapes.size(); id++ )
+            {
+                const AABB& box = shapes[id].box;
+                for( uint32_t y = cell_y(box.min.y); y <= cell_y(box.max.y); y++ )
+                    for( uint32_t x = cell_x(box.min.x); x <= cell_x(box.max.x); x++ )
+                    {
+                        uint32_t c = y * columns + x;
+                        if( pass == 0 ) cell_start[c + 1]++;
+                        else cell_items[--cell_start[c + 1]] = id;
+                    }
+            }
+        }
+        // the second pass filled every cell backwards from its end, which left cell_start[c + 1] at the start of c
+        cell_start.erase(cell_start.begin());
+        cell_start.push_back((uint32_t)cell_items.size());
+    }
+
+    bool inside_grid( const v2& point ) const
+    {
+        return point.x >= bounds.min.x && point.x <= bounds.max.x && point.y >= bounds.min.y && point.y <= bounds.max.y;
+    }
+
+    uint32_t cell_x( double x ) const { return (uint32_t)std::min(std::max((x - bounds.min.x) / cell, 0.0), columns - 1.0); }
+    uint32_t cell_y( double y ) const { return (uint32_t)std::min(std::max((y - bounds.min.y) / cell, 0.0), rows - 1.0); }
+
+    void next_stamp( Scratch& scratch ) const
+    {
+        if( ++scratch.stamp == 0 )
+        {
+            std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+            scratch.stamp = 1;
+        }
+    }
+};
+
+// A piece of the input and the results for it; a fixed number of them circulate between the stages.
+struct Block
+{
+    uint64_t sequence = 0;
+    uint64_t offset = 0;            // of the input in the stream, for error messages
+    std::vector<char> input;
+    size_t length = 0;
+    std::string output;
+    uint64_t queries = 0;
+    const char* error = nullptr;
+    uint64_t error_offset = 0;
+};
+
+// unbounded by itself; the number of blocks bounds it
+class Block_queue
+{
+public:
+    void push( Block* block )
+    {
+        { std::lock_guard<std::mutex> guard(lock); blocks.push_back(block); }
+        ready.notify_one();
+    }
+
+    // null once the queue is closed and empty
+    Block* pop()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        ready.wait(guard, [&]{ return !blocks.empty() || closed; });
+        if( blocks.empty() ) return nullptr;
+        Block* block = blocks.front();
+        blocks.pop_front();
+        return block;
+    }
+
+    void close()
+    {
+        { std::lock_guard<std::mutex> guard(lock); closed = true; }
+        ready.notify_all();
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Block*> blocks;
+    bool closed = false;
+};
+
+// Hands the evaluated blocks to the writer in input order.
+class Reorder
+{
+public:
+    explicit Reorder( size_t blocks ) : slots(blocks, nullptr) {}
+
+    void put( Block* block )
+    {
+        { std::lock_guard<std::mutex> guard(lock); slots[block->sequence % slots.size()] = block; }
+        ready.notify_all();
+    }
+
+    // the next block in order, null once all `total` blocks were taken or the pipeline stopped
+    Block* take()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        Block*& slot = slots[next % slots.size()];
+        ready.wait(guard, [&]{ return (slot && slot->sequence == next) || next == total || stopped; });
+        if( stopped || next == total ) return nullptr;
+        Block* block = slot;
+        slot = nullptr;
+        next++;
+        return block;
+    }
+
+    void finish( uint64_t blocks )
+    {
+        { std::lock_guard<std::mutex> guard(lock); total = blocks; }
+        ready.notify_all();
+    }
+
+    void stop()
+    {
+        { std::lock_guard<std::mutex> guard(lock); stopped = true; }
+        ready.notify_all();
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::vector<Block*> slots;
+    uint64_t next = 0, total = UINT64_MAX;
+    bool stopped = false;
+};
+
+struct Options
+{
+    std::vector<v2> robot;
+    bool binary = false;
+    bool stats = false;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string output;
+};
+
+static const size_t BLOCK_BYTES = 1 << 20;
+
+static inline const char* skip_blanks( const char* p, const char* end )
+{
+    while( p < end && (*p == ' ' || *p == '\t' || *p == '\r') ) p++;
+    return p;
+}
+
+static inline const char* parse_number( const char* p, const char* end, double& value )
+{
+    p = skip_blanks(p, end);
+    if( p < end && *p == '+' ) p++;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if( result.ec != std::errc() ) throw "expected a number";
+    return result.ptr;
+}
+
+static inline void append_result( std::string& out, QUERY kind, double value, bool binary )
+{
+    // no obstacle is inf in both formats, whatever the query code uses for it
+    if( kind == QUERY::DISTANCE && value >= MAX_DOUBLE ) value = std::numeric_limits<double>::infinity();
+    if( binary )
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(double));
+        return;
+    }
+    if( kind != QUERY::DISTANCE )
+    {
+        out.push_back(value != 0.0 ? '1' : '0');
+        out.push_back('\n');
+        return;
+    }
+    char text[32];
+    char* end = std::isinf(value) ? std::strcpy(text, "inf") + 3 : std::to_chars(text, text + sizeof(text), value).ptr;
+    *end++ = '\n';
+    out.append(text, end);
+}
+
+static inline double evaluate( const Scene_index& index, Scene_index::Scratch& scratch, const std::vector<v2>& robot, QUERY kind, double x, double y, double theta )
+{
+    if( kind == QUERY::POINT )
+        return index.contains(v2(x, y));
+    if( robot.empty() )
+        throw "pose queries need --robot";
+    double c = cos(theta), s = sin(theta);
+    for( size_t i = 0; i < robot.size(); i++ )
+        scratch.footprint[i] = v2(robot[i].x * c - robot[i].y * s + x, robot[i].x * s + robot[i].y * c + y);
+    Polygon_view footprint(scratch.footprint.data(), (unsigned)robot.size());
+    return kind == QUERY::COLLIDE ? index.intersects(footprint, scratch) : index.distance_to(footprint, scratch);
+}
+
+// The parse and evaluate stage for one block.
+static void evaluate_block( Block& block, const Scene_index& index, Scene_index::Scratch& scratch, const Options& options )
+{
+    block.output.clear();
+    block.queries = 0;
+    const char* begin = block.input.data();
+    const char* end = begin + block.length;
+    const char* line = begin;
+    try
+    {
+        if( options.binary )
+        {
+            for( ; line < end; line += sizeof(Query_record) )
+            {
+                Query_record record;
+                std::memcpy(&record, line, sizeof(record));
+                if( record.kind > (uint32_t)QUERY::DISTANCE ) throw "unknown query kind";
+                QUERY kind = (QUERY)record.kind;
+                append_result(block.output, kind, evaluate(index, scratch, options.robot, kind, record.x, record.y, record.theta), true);
+                block.queries++;
+            }
+            return;
+        }
+        while( line < end )
+        {
+            const char* line_end = (const char*)std::memchr(line, '\n', end - line);
+            if( !line_end ) line_end = end;
+            const char* p = skip_blanks(line, line_end);
+            if( p < line_end && *p != '#' )
+            {
+                QUERY kind;
+                switch( *p )
+                {
+                    case 'p': kind = QUERY::POINT; break;
+                    case 'c': kind = QUERY::COLLIDE; break;
+                    case 'd': kind = QUERY::DISTANCE; break;
+                    default: throw "unknown query, expected p, c or d";
+                }
+                while( p < line_end && *p != ' ' && *p != '\t' ) p++;
+                double x, y, theta = 0.0;
+                p = parse_number(p, line_end, x);
+                p = parse_number(p, line_end, y);
+                if( kind != QUERY::POINT ) p = parse_number(p, line_end, theta);
+                if( skip_blanks(p, line_end) != line_end ) throw "too many numbers";
+                append_result(block.output, kind, evaluate(index, scratch, options.robot, kind, x, y, theta), false);
+                block.queries++;
+            }
+            line = line_end + 1;
+        }
+    }
+    catch( const char* error )
+    {
+        block.error = error;
+        block.error_offset = block.offset + (line - begin);
+    }
+}
+
+/* Runs the pipeline: this thread reads, options.threads threads evaluate, one thread writes.
+ * Returns false if a query was malformed.
+ */
+static bool run( const Scene_index& index, std::FILE* in, std::FILE* out, const Options& options, uint64_t& queries )
+{
+    const size_t block_count = 2 * options.threads + 2;
+    std::vector<Block> blocks(block_count);
+    Block_queue free_blocks, work;
+    Reorder done(block_count);
+    for( Block& block : blocks )
+    {
+        block.input.resize(BLOCK_BYTES);
+        free_blocks.push(&block);
+    }
+
+    std::atomic<bool> failed(false);
+    std::string error;
+    std::mutex error_lock;
+    auto fail = [&]( const std::string& message ){
+        {
+            std::lock_guard<std::mutex> guard(error_lock);
+            if( error.empty() ) error = message;
+        }
+        failed = true;
+        free_blocks.close();
+        work.close();
+        done.stop();
+    };
+
+    std::vector<std::thread> workers;
+    for( unsigned t = 0; t < options.threads; t++ )
+        workers.emplace_back([&]{
+            Scene_index::Scratch scratch;
+            index.prepare(scratch);
+            scratch.footprint.resize(options.robot.size());
+            while( Block* block = work.pop() )
+            {
+                evaluate_block(*block, index, scratch, options);
+                done.put(block);
+            }
+        });
+
+    queries = 0;
+    std::thread writer([&]{
+        while( Block* block = done.take() )
+        {
+            // a failed block still holds the results of the queries before the bad one
+            if( std::fwrite(block->output.data(), 1, block->output.size(), out) != block->output.size() )
+                return fail("cannot write the results");
+            queries += block->queries;
+            if( block->error )
+                return fail(std::string(block->error) + " at byte " + std::to_string(block->error_offset));
+            free_blocks.push(block);
+        }
+    });
+
+    // the read stage: whole lines (or records) per block, the rest carries over to the next one
+    const size_t unit = options.binary ? sizeof(Query_record) : 1;
+    std::vector<char> carry;
+    uint64_t sequence = 0, offset = 0;
+    bool eof = false;
+    while( !eof && !failed )
+    {
+        Block* block = free_blocks.pop();
+        if( !block ) break;
+        std::memcpy(block->input.data(), carry.data(), carry.size());
+        size_t length = carry.size();
+        length += std::fread(block->input.data() + length, 1, block->input.size() - length, in);
+        eof = length < block->input.size();
+        if( eof && std::ferror(in) ) { fail("cannot read the queries"); break; }
+
+        size_t cut = length;
+        if( !eof )
+        {
+            if( options.binary )
+                cut = length / unit * unit;
+            else
+            {
+                while( cut > 0 && block->input[cut - 1] != '\n' ) cut--;
+                if( cut == 0 ) { fail("query line longer than " + std::to_string(BLOCK_BYTES) + " bytes"); break; }
+            }
+        }
+        else if( options.binary && length % unit != 0 )
+        {
+            fail("the queries end in a partial record");
+            break;
+        }
+        carry.assign(block->input.begin() + cut, block->input.begin() + length);
+        block->sequence = sequence++;
+        block->offset = offset;
+        block->length = cut;
+        block->error = nullptr;
+        offset += cut;
+        work.push(block);
+    }
+    done.finish(sequence);
+    work.close();
+    writer.join();
+    for( std::thread& worker : workers ) worker.join();
+    std::fflush(out);
+
+    if( failed )
+        std::cerr << "batch_query: " << error << std::endl;
+    return !failed;
+}
+
+// Random queries over the scene bounds, a third of each kind.
+static void generate( const Scene_file& scene, uint64_t count, unsigned seed, bool binary, std::FILE* out )
+{
+    AABB region;
+    for( uint64_t i = 0; i < scene.polygon_count(); i++ )
+    {
+        AABB box = scene.bounds(i);
+        region.expand(box.min);
+        region.expand(box.max);
+    }
+    for( uint64_t i = 0; i < scene.sphere_count(); i++ )
+        region.expand(scene.get_sphere(i).center());
+    if( region.min.x > region.max.x ) region = AABB(v2(0, 0), v2(1, 1));
+
+    Scene_generator generator(seed);
+    std::string buffer;
+    for( uint64_t i = 0; i < count; i++ )
+    {
+        QUERY kind = (QUERY)generator.integer(0, 2);
+        v2 p = generator.random_point(region);
+        double theta = generator.uniform(0.0, 2 * PI);
+        if( binary )
+        {
+            Query_record record{(uint32_t)kind, 0, p.x, p.y, theta};
+            buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+        else
+        {
+            char line[96];
+            int n = kind == QUERY::POINT ? std::snprintf(line, sizeof(line), "p %.6f %.6f\n", p.x, p.y)
+                                         : std::snprintf(line, sizeof(line), "%c %.6f %.6f %.4f\n", kind == QUERY::COLLIDE ? 'c' : 'd', p.x, p.y, theta);
+            buffer.append(line, n);
+        }
+        if( buffer.size() >= BLOCK_BYTES )
+        {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+}
+
+static int usage()
+{
+    std::cerr <<
+        "usage: batch_query [options] scene.n2ds [queries]\n"
+        "       batch_query import scene.txt scene.n2ds\n"
+        "       batch_query generate [--binary] scene.n2ds count [seed]\n"
+        "options:\n"
+        "    --robot \"x1 y1 x2 y2 ...\"   convex footprint for pose queries\n"
+        "    --binary                    binary queries and results\n"
+        "    --threads n                 evaluating threads\n"
+        "    --output path               results to a file instead of stdout\n"
+        "    --stats                     throughput on stderr\n";
+    return 2;
+}
+
+int main( int argc, const char* argv[] )
+{
+    try
+    {
+        std::vector<std::string> args(argv + 1, argv + argc);
+        if( !args.empty() && args[0] == "import" )
+        {
+            if( args.size() != 3 ) return usage();
+            std::ifstream in(args[1]);
+            if( !in ) throw "cannot open the text scene";
+            Scene_writer writer(args[2]);
+            import_text_scene(in, writer);
+            writer.finish();
+            return 0;
+        }
+        bool generating = !args.empty() && args[0] == "generate";
+        if( generating ) args.erase(args.begin());
+
+        Options options;
+        std::vector<std::string> positional;
+        for( size_t i = 0; i < args.size(); i++ )
+        {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if( arg == "--binary" ) options.binary = true;
+            else if( arg == "--stats" ) options.stats = true;
+            else if( arg == "--threads" && has_value ) options.threads = std::max(1, std::atoi(args[++i].c_str()));
+            else if( arg == "--output" && has_value ) options.output = args[++i];
+            else if( arg == "--robot" && has_value )
+            {
+                const std::string& text = args[++i];
+                const char* p = text.c_str();
+                const char* end = p + text.size();
+                while( skip_blanks(p, end) != end )
+                {
+                    double x, y;
+                    p = parse_number(p, end, x);
+                    p = parse_number(p, end, y);
+                    options.robot.push_back(v2(x, y));
+                }
+                if( options.robot.size() < 3 ) throw "the robot needs at least 3 vertices";
+            }
+            else if( arg.size() > 1 && arg[0] == '-' && arg[1] == '-' ) return usage();
+            else positional.push_back(arg);
+        }
+
+        std::FILE* out = stdout;
+        if( !options.output.empty() && !(out = std::fopen(options.output.c_str(), "wb")) )
+            throw "cannot open the output";
+
+        if( generating )
+        {
+            if( positional.size() < 2 || positional.size() > 3 ) return usage();
+            Scene_file scene(positional[0]);
+            generate(scene, std::stoull(positional[1]), positional.size() == 3 ? std::atoi(positional[2].c_str()) : 2026, options.binary, out);
+            if( out != stdout ) std::fclose(out);
+            return 0;
+        }
+
+        if( positional.empty() || positional.size() > 2 ) return usage();
+        std::FILE* in = stdin;
+        if( positional.size() == 2 && positional[1] != "-" && !(in = std::fopen(positional[1].c_str(), "rb")) )
+            throw "cannot open the queries";
+
+        auto start = std::chrono::steady_clock::now();
+        Scene_file scene(positional[0]);
+        Scene_index index(scene);
+        auto loaded = std::chrono::steady_clock::now();
+        uint64_t queries = 0;
+        bool ok = run(index, in, out, options, queries);
+        auto end = std::chrono::steady_clock::now();
+
+        if( options.stats )
+        {
+            double load = std::chrono::duration<double>(loaded - start).count(), seconds = std::chrono::duration<double>(end - loaded).count();
+            std::cerr << index.size() << " obstacles loaded in " << load * 1000 << " ms, " << queries << " queries in " << seconds << " s, "
+                      << queries / seconds / 1e6 << " million queries per second on " << options.threads << " threads" << std::endl;
+        }
+        if( in != stdin ) std::fclose(in);
+        if( out != stdout ) std::fclose(out);
+        return ok ? 0 : 1;
+    }
+    catch( const char* error )
+    {
+        std::cerr << "batch_query: " << error << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,263 @@
+//
+//  collision_cache.h
+//  Naive2D
+//
+//  Memoizes collision queries of a robot against a set of static obstacles.
+//  A configuration (x, y, theta) is snapped to a grid of position_step and
+//  angle_step, and the result for the snapped configuration is cached in a
+//  bounded, thread safe LRU. Sampling based planners (PRM, RRT) re-test the
+//  same or nearly the same configurations all the time, which then become
+//  hash lookups.
+//
+//  Note the result is exact for the snapped configuration, not for the one
+//  asked for, so pick steps below the resolution the planner cares about.
+//
+
+#ifndef Naive2D_collision_cache_h
+#define Naive2D_collision_cache_h
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    class Collision_cache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t hits, misses, evictions, size;
+            double hit_rate() const { return hits + misses == 0 ? 0.0 : double(hits) / double(hits + misses); }
+        };
+
+        /* @param robot: the robot shape at configuration (0, 0, 0); it rotates about the origin.
+         * @param obstacles: the obstacles, owned by the caller. Call invalidate() after changing them.
+         * @param position_step: grid size used to quantize x and y
+         * @param angle_step: grid size used to quantize theta (radians), rounded to divide 2 pi
+         * @param capacity: maximum number of cached results
+         * @param shards: number of independently locked LRUs, to reduce contention
+         */
+        Collision_cache( const Polygon& robot, const std::vector<Polygon>& obstacles, double position_step, double angle_step, size_t capacity = 1 << 20, unsigned shards = 16 )
+            : robot(robot), obstacles(&obstacles), position_step(position_step), angle_step(angle_step),
+              angle_cells(checked_angle_cells(position_step, angle_step, capacity, shards)), shard_count(shards), shards(new Shard[shards])
+        {
+            // round the angle step so that the grid wraps around exactly at 2 pi
+            this->angle_step = 2 * PI / angle_cells;
+            size_t per_shard = (capacity + shards - 1) / shards;
+            for( unsigned i = 0; i < shards; i++ )
+                this->shards[i].capacity = per_shard;
+        }
+
+        Collision_cache( const Collision_cache& ) = delete;
+        Collision_cache& operator=( const Collision_cache& ) = delete;
+
+        /* Use another obstacle set. Cached results of the old set are never returned again.
+         * Safe to call during queries: the pointer is published before the version, so a query that
+         * keys its result with the new version also reads the new obstacles. The old set has to stay
+         * alive until the queries running meanwhile return.
+         */
+        void set_obstacles( const std::vector<Polygon>& obstacles )
+        {
+            this->obstacles.store(&obstacles, std::memory_order_release);
+            invalidate();
+        }
+
+        // Call after the obstacles changed. Old entries age out of the LRU.
+        void invalidate() { version++; }
+
+        uint64_t obstacle_version() const { return version.load(); }
+
+        // Returns true if the robot at the (snapped) configuration intersects any obstacle.
+        bool intersects( double x, double y, double theta )
+        {
+            Key key = make_key(x, y, theta, INTERSECTS);
+            double value;
+            if( lookup(key, value) )
+                return value != 0.0;
+            bool hit = false;
+            Polygon_view placed = place(key);
+            // read after the key's version, see set_obstacles()
+            for( const Polygon& obstacle : *obstacles.load(std::memory_order_acquire) )
+            {
+                if( placed.intersects(obstacle.view()) )
+                {
+                    hit = true;
+                    break;
+                }
+            }
+            store(key, hit ? 1.0 : 0.0);
+            return hit;
+        }
+
+        // Returns the distance from the robot at the (snapped) configuration to the nearest obstacle.
+        double distance_to( double x, double y, double theta )
+        {
+            Key key = make_key(x, y, theta, DISTANCE);
+            double value;
+            if( lookup(key, value) )
+                return value;
+            double min = MAX_DOUBLE;
+            Polygon_view placed = place(key);
+            for( const Polygon& obstacle : *obstacles.load(std::memory_order_acquire) )
+            {
+                min = std::min(min, placed.distance_to(obstacle.view()));
+                if( min == 0.0 ) break;
+            }
+            store(key, min);
+            return min;
+        }
+
+        Stats stats() const
+        {
+            Stats result{hits.load(), misses.load(), evictions.load(), 0};
+            for( unsigned i = 0; i < shard_count; i++ )
+            {
+                std::lock_guard<std::mutex> lock(shards[i].mutex);
+                result.size += shards[i].lru.size();
+            }
+            return result;
+        }
+
+        void reset_stats() { hits = 0; misses = 0; evictions = 0; }
+
+        // Drops every cached result.
+        void clear()
+        {
+            for( unsigned i = 0; i < shard_count; i++ )
+            {
+                std::lock_guard<std::mutex> lock(shards[i].mutex);
+                shards[i].lru.clear();
+                shards[i].index.clear();
+            }
+        }
+
+    private:
+        enum Query : uint32_t { INTERSECTS, DISTANCE };
+
+        struct Key
+        {
+            int64_t x, y;
+            int64_t theta;
+            uint64_t version;
+            uint32_t query;
+
+            bool operator==( const Key& other ) const
+            {
+                return x == other.x && y == other.y && theta == other.theta && version == other.version && query == other.query;
+            }
+        };
+
+        struct Key_hash
+        {
+            size_t operator()( const Key& key ) const
+            {
+                uint64_t h = 1469598103934665603ull;
+                for( uint64_t v : {uint64_t(key.x), uint64_t(key.y), uint64_t(key.theta), key.version, uint64_t(key.query)} )
+                    h = (h ^ v) * 1099511628211ull;
+                return (size_t)(h ^ (h >> 29));
+            }
+        };
+
+        struct Shard
+        {
+            std::mutex mutex;
+            size_t capacity = 0;
+            std::list<std::pair<Key, double>> lru;   // most recently used first
+            std::unordered_map<Key, std::list<std::pair<Key, double>>::iterator, Key_hash> index;
+        };
+
+        // Validates the arguments in the init list, before angle_cells and the shards are computed from them.
+        static int64_t checked_angle_cells( double position_step, double angle_step, size_t capacity, unsigned shards )
+        {
+            // written so that NaN fails too
+            if( !(position_step > 0) || !(angle_step > 0) || capacity == 0 || shards == 0 )
+                throw "Collision_cache: steps, capacity and shards have to be positive.";
+            double cells = std::ceil(2 * PI / angle_step);
+            if( !(cells <= double(1 << 30)) )
+                throw "Collision_cache: angle_step is too small.";
+            return (int64_t)cells;
+        }
+
+        Polygon robot;
+        std::atomic<const std::vector<Polygon>*> obstacles;
+        double position_step, angle_step;
+        int64_t angle_cells;
+        unsigned shard_count;
+        std::unique_ptr<Shard[]> shards;
+        std::atomic<uint64_t> version{0};
+        std::atomic<uint64_t> hits{0}, misses{0}, evictions{0};
+
+        Key make_key( double x, double y, double theta, Query query ) const
+        {
+            Key key;
+            key.x = (int64_t)std::llround(x / position_step);
+            key.y = (int64_t)std::llround(y / position_step);
+            key.theta = (int64_t)std::llround(theta / angle_step) % angle_cells;
+            if( key.theta < 0 ) key.theta += angle_cells;
+            key.version = version.load();
+            key.query = query;
+            return key;
+        }
+
+        Shard& shard_of( const Key& key ) { return shards[Key_hash()(key) % shard_count]; }
+
+        bool lookup( const Key& key, double& value )
+        {
+            Shard& shard = shard_of(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if( it == shard.index.end() )
+            {
+                misses++;
+                return false;
+            }
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            value = it->second->second;
+            hits++;
+            return true;
+        }
+
+        void store( const Key& key, double value )
+        {
+            Shard& shard = shard_of(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            // another thread may have computed the same configuration meanwhile.
+            if( shard.index.count(key) ) return;
+            shard.lru.emplace_front(key, value);
+            shard.index[key] = shard.lru.begin();
+            if( shard.lru.size() > shard.capacity )
+            {
+                shard.index.erase(shard.lru.back().first);
+                shard.lru.pop_back();
+                evictions++;
+            }
+        }
+
+        // The robot at the snapped configuration, in a per thread buffer.
+        Polygon_view place( const Key& key ) const
+        {
+            static thread_local std::vector<v2> buffer;
+            double theta = key.theta * angle_step;
+            double cos_theta = cos(theta), sin_theta = sin(theta);
+            v2 offset(key.x * position_step, key.y * position_step);
+            buffer.resize(robot.vertices.size());
+            for( size_t i = 0; i < buffer.size(); i++ )
+            {
+                const v2& p = robot.vertices[i];
+                buffer[i] = v2(p.x * cos_theta - p.y * sin_theta, p.x * sin_theta + p.y * cos_theta) + offset;
+            }
+            return Polygon_view(buffer.data(), (unsigned)buffer.size());
+        }
+    };
+}
+
+#endif
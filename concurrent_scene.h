@@ -0,0 +1,410 @@
+//
+//  concurrent_scene.h
+//  Naive2D
+//
+//  A set of obstacles that one thread moves while many threads query it,
+//  without a global lock and without copying every polygon on every tick.
+//
+//      Concurrent_scene scene(std::move(obstacles));
+//
+//      // writer thread
+//      scene.translate(id, v2(0.1, 0));
+//      scene.rotate(other, 0.05, center);
+//      scene.publish();                    // both moves become visible at once
+//
+//      // any planner thread
+//      Concurrent_scene::Reader reader(scene);
+//      {
+//          Concurrent_scene::Snapshot snapshot = reader.pin();
+//          if( snapshot.intersects(robot.view()) ) ...
+//      }
+//
+//  A published version is never modified. The writer stages its changes in
+//  a copy of the version's table, which is cut into chunks of CHUNK_SIZE
+//  entries so only the chunks it touched are copied; the other chunks and
+//  every unchanged polygon are shared with the versions before. publish()
+//  then swaps the current version with one atomic exchange and bumps the
+//  epoch.
+//
+//  Everything a publish replaced (the old table, the old chunks, the old
+//  polygons) is retired under the new epoch and freed once no reader can
+//  still see it. A reader pins by writing the epoch into its own slot before
+//  it loads the current version, so anything retired under a later epoch
+//  than the smallest pinned one stays alive (epoch based reclamation). Reads
+//  take no lock and write no shared cache line; a reader that stays pinned
+//  only delays the freeing, never the writer.
+//
+//  Only one thread may call the writer methods (add, replace, translate,
+//  rotate, remove, publish); use a mutex around them if there are several.
+//
+//  Reference:
+//      K. Fraser, Practical lock-freedom, chapter 5 (epoch based reclamation).
+//      P. McKenney, J. Slingwine, Read-copy update: using execution history
+//      to solve concurrency problems.
+//
+
+#ifndef Naive2D_concurrent_scene_h
+#define Naive2D_concurrent_scene_h
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "GJK_utility.h"
+
+namespace N2D {
+
+    class Concurrent_scene
+    {
+    public:
+        typedef uint32_t id_type;
+
+        // entries per chunk of the version table
+        static constexpr uint32_t CHUNK_SIZE = 64;
+
+        // a slot that is not pinned
+        static constexpr uint64_t IDLE = UINT64_MAX;
+
+        // One obstacle of a version; polygon is null once it is removed.
+        struct Entry
+        {
+            const Polygon* polygon = nullptr;
+            AABB box;
+        };
+
+    private:
+        struct Chunk
+        {
+            Entry entries[CHUNK_SIZE];
+        };
+
+        // an immutable version of the scene
+        struct Version
+        {
+            uint64_t number = 0;
+            uint32_t size = 0;
+            std::vector<const Chunk*> chunks;
+        };
+
+        // one reader's pinned epoch, on its own cache line
+        struct alignas(64) Slot
+        {
+            std::atomic<uint64_t> epoch{IDLE};
+            std::atomic<bool> taken{false};
+        };
+
+    public:
+        /* A consistent view of one version. The version, and every polygon in it, stays alive
+         * until the snapshot is destroyed, whatever the writer does in the meantime.
+         */
+        class Snapshot
+        {
+        public:
+            Snapshot( Snapshot&& other ) : slot(other.slot), version(other.version) { other.slot = nullptr; }
+            Snapshot( const Snapshot& ) = delete;
+            Snapshot& operator=( const Snapshot& ) = delete;
+            ~Snapshot() { if( slot ) slot->epoch.store(IDLE, std::memory_order_release); }
+
+            uint64_t version_number() const { return version->number; }
+
+            // ids run from 0 to size() - 1, removed ones included
+            id_type size() const { return version->size; }
+
+            // null if the obstacle is removed
+            const Polygon* operator[]( id_type id ) const { return entry(id).polygon; }
+
+            const Entry& entry( id_type id ) const { return version->chunks[id / CHUNK_SIZE]->entries[id % CHUNK_SIZE]; }
+
+            // f(id, polygon, box) for every obstacle that is not removed
+            template <class F>
+            void for_each( F f ) const
+            {
+                for( id_type id = 0; id < version->size; id++ )
+                {
+                    const Entry& e = entry(id);
+                    if( e.polygon ) f(id, *e.polygon, e.box);
+                }
+            }
+
+            // Whether a convex shape overlaps any of the (convex) obstacles.
+            bool intersects( const Polygon_view& shape ) const
+            {
+                AABB box = shape.bounds();
+                for( id_type id = 0; id < version->size; id++ )
+                {
+                    const Entry& e = entry(id);
+                    if( e.polygon && e.box.overlaps(box) &&
+                        GJK::intersects(shape.vertices, shape.size, e.polygon->vertices.data(), (unsigned)e.polygon->vertices.size()) )
+                        return true;
+                }
+                return false;
+            }
+
+            // Distance from a convex shape to the nearest (convex) obstacle, MAX_DOUBLE if there is none.
+            double distance_to( const Polygon_view& shape ) const
+            {
+                AABB box = shape.bounds();
+                double best = MAX_DOUBLE;
+                for( id_type id = 0; id < version->size; id++ )
+                {
+                    const Entry& e = entry(id);
+                    if( !e.polygon ) continue;
+                    double dx = std::max(0.0, std::max(e.box.min.x - box.max.x, box.min.x - e.box.max.x));
+                    double dy = std::max(0.0, std::max(e.box.min.y - box.max.y, box.min.y - e.box.max.y));
+                    if( dx * dx + dy * dy >= best * best ) continue;
+                    best = std::min(best, GJK::distance(shape.vertices, shape.size, e.polygon->vertices.data(), (unsigned)e.polygon->vertices.size()));
+                    if( best == 0.0 ) break;
+                }
+                return best;
+            }
+
+        private:
+            friend class Concurrent_scene;
+            Snapshot( Slot* slot, const Version* version ) : slot(slot), version(version) {}
+
+            Slot* slot;
+            const Version* version;
+        };
+
+        /* A reader thread's registration: claims one of the scene's slots until it is destroyed.
+         * Keep one per thread and pin it whenever a consistent view is needed. The slot holds one
+         * epoch, so a reader holds at most one snapshot at a time, and the snapshot has to be
+         * destroyed before the reader.
+         */
+        class Reader
+        {
+        public:
+            explicit Reader( Concurrent_scene& scene ) : scene(scene), slot(scene.claim_slot()) {}
+            Reader( const Reader& ) = delete;
+            Reader& operator=( const Reader& ) = delete;
+            ~Reader()
+            {
+                bool pinned = slot->epoch.load(std::memory_order_relaxed) != IDLE;
+                assert(!pinned && "Concurrent_scene: a snapshot outlives its reader.");
+                // never hand a slot that is still pinned to another reader; it stays claimed instead
+                if( !pinned ) slot->taken.store(false, std::memory_order_release);
+            }
+
+            // Throws if the reader still holds a snapshot: pinning again would unpin that one early.
+            Snapshot pin() const
+            {
+                if( slot->epoch.load(std::memory_order_relaxed) != IDLE )
+                    throw "Concurrent_scene: the reader already holds a snapshot.";
+                // The slot is written before the version is loaded (both seq_cst), so either the writer
+                // sees this epoch when it reclaims, or this load sees the version it just published.
+                slot->epoch.store(scene.epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                return Snapshot(slot, scene.current.load(std::memory_order_seq_cst));
+            }
+
+        private:
+            Concurrent_scene& scene;
+            Slot* slot;
+        };
+
+        explicit Concurrent_scene( std::vector<Polygon> obstacles = std::vector<Polygon>(), unsigned max_readers = 64 )
+            : slots(new Slot[max_readers]), slot_count(max_readers)
+        {
+            staged.number = 0;
+            for( Polygon& polygon : obstacles )
+                add(std::move(polygon));
+            const Version* first = new Version(staged);
+            current.store(first, std::memory_order_seq_cst);
+            fresh.assign(fresh.size(), false);
+            retiring.clear();
+        }
+
+        Concurrent_scene( const Concurrent_scene& ) = delete;
+        Concurrent_scene& operator=( const Concurrent_scene& ) = delete;
+
+        // No reader may be pinned any more.
+        ~Concurrent_scene()
+        {
+            for( const Retired& r : retired ) r.free();
+            for( const Retired& r : retiring ) r.free();
+            const Version* last = current.load(std::memory_order_relaxed);
+            for( id_type id = 0; id < staged.size; id++ )
+                delete entry(id).polygon;
+            for( const Chunk* chunk : staged.chunks ) delete chunk;
+            delete last;
+        }
+
+        /*** writer side ***/
+
+        // The staged (not yet published) state of an obstacle; null if it is removed.
+        const Polygon* staged_polygon( id_type id ) const { return entry(id).polygon; }
+
+        // Number of obstacles staged, removed ones included.
+        id_type staged_size() const { return staged.size; }
+
+        id_type add( Polygon&& polygon )
+        {
+            id_type id = staged.size++;
+            if( id % CHUNK_SIZE == 0 )
+            {
+                staged.chunks.push_back(new Chunk());
+                fresh.push_back(true);
+            }
+            Entry& e = writable(id);
+            e.box = polygon.bounds();
+            e.polygon = new Polygon(std::move(polygon));
+            return id;
+        }
+
+        void replace( id_type id, Polygon&& polygon )
+        {
+            check(id);
+            Entry& e = writable(id);
+            if( e.polygon ) retire(e.polygon);
+            e.box = polygon.bounds();
+            e.polygon = new Polygon(std::move(polygon));
+        }
+
+        void translate( id_type id, const v2& vect )
+        {
+            Polygon moved = moved_copy(id);
+            moved.self_translate(vect);
+            replace(id, std::move(moved));
+        }
+
+        void rotate( id_type id, double dtheta, const v2& center )
+        {
+            Polygon moved = moved_copy(id);
+            moved.self_rotate(dtheta, center);
+            replace(id, std::move(moved));
+        }
+
+        // The id is not reused.
+        void remove( id_type id )
+        {
+            check(id);
+            Entry& e = writable(id);
+            if( e.polygon ) retire(e.polygon);
+            e.polygon = nullptr;
+            e.box = AABB();
+        }
+
+        /* Makes everything staged since the last publish visible to the snapshots pinned from now
+         * on, all at once, and frees what no pinned snapshot can see any more.
+         */
+        void publish()
+        {
+            staged.number++;
+            const Version* next = new Version(staged);
+            const Version* previous = current.exchange(next, std::memory_order_seq_cst);
+            uint64_t epoch_now = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+            retiring.push_back(Retired{Retired::VERSION, previous});
+            for( Retired& r : retiring )
+            {
+                r.epoch = epoch_now;
+                retired.push_back(r);
+            }
+            retiring.clear();
+            fresh.assign(fresh.size(), false);
+            reclaim();
+        }
+
+        // Frees what every pinned snapshot is past; publish() already calls it.
+        void reclaim()
+        {
+            uint64_t oldest = IDLE;
+            for( unsigned i = 0; i < slot_count; i++ )
+                oldest = std::min(oldest, slots[i].epoch.load(std::memory_order_seq_cst));
+            // retired is sorted by epoch
+            size_t freed = 0;
+            while( freed < retired.size() && retired[freed].epoch <= oldest )
+                retired[freed++].free();
+            retired.erase(retired.begin(), retired.begin() + freed);
+            reclaimed += freed;
+        }
+
+        // versions, chunks and polygons waiting for pinned readers
+        size_t retired_count() const { return retired.size(); }
+
+        size_t reclaimed_count() const { return reclaimed; }
+
+        // the version the next publish will make current
+        uint64_t staged_version() const { return staged.number + 1; }
+
+    private:
+        // Something a publish replaced, freed once no slot is pinned at an epoch before `epoch`.
+        struct Retired
+        {
+            enum KIND { VERSION, CHUNK, POLYGON } kind;
+            const void* object;
+            uint64_t epoch = 0;
+
+            void free() const
+            {
+                switch( kind )
+                {
+                    case VERSION: delete static_cast<const Version*>(object); break;
+                    case CHUNK:   delete static_cast<const Chunk*>(object); break;
+                    case POLYGON: delete static_cast<const Polygon*>(object); break;
+                }
+            }
+        };
+
+        std::atomic<const Version*> current{nullptr};
+        std::atomic<uint64_t> epoch{0};
+        std::unique_ptr<Slot[]> slots;
+        unsigned slot_count;
+
+        // writer only
+        Version staged;                 // its chunks are shared with current, except the fresh ones
+        std::vector<bool> fresh;        // chunks copied (or added) since the last publish
+        std::vector<Retired> retiring;  // replaced since the last publish
+        std::vector<Retired> retired;   // published, waiting for readers
+        size_t reclaimed = 0;
+
+        Slot* claim_slot()
+        {
+            for( unsigned i = 0; i < slot_count; i++ )
+            {
+                bool expected = false;
+                if( !slots[i].taken.load(std::memory_order_relaxed) &&
+                    slots[i].taken.compare_exchange_strong(expected, true, std::memory_order_acquire) )
+                    return &slots[i];
+            }
+            throw "Too many readers for the concurrent scene.";
+        }
+
+        void check( id_type id ) const
+        {
+            if( id >= staged.size )
+                throw "No obstacle with this id in the concurrent scene.";
+        }
+
+        const Entry& entry( id_type id ) const { return staged.chunks[id / CHUNK_SIZE]->entries[id % CHUNK_SIZE]; }
+
+        // copy on write: a chunk the current version can see is copied once per publish
+        Entry& writable( id_type id )
+        {
+            uint32_t c = id / CHUNK_SIZE;
+            if( !fresh[c] )
+            {
+                retiring.push_back(Retired{Retired::CHUNK, staged.chunks[c]});
+                staged.chunks[c] = new Chunk(*staged.chunks[c]);
+                fresh[c] = true;
+            }
+            return const_cast<Chunk*>(staged.chunks[c])->entries[id % CHUNK_SIZE];
+        }
+
+        Polygon moved_copy( id_type id ) const
+        {
+            check(id);
+            const Polygon* polygon = entry(id).polygon;
+            if( !polygon )
+                throw "The obstacle was removed from the concurrent scene.";
+            return *polygon;
+        }
+
+        void retire( const Polygon* polygon ) { retiring.push_back(Retired{Retired::POLYGON, polygon}); }
+    };
+}
+
+#endif
@@ -0,0 +1,288 @@
+//
+//  contact.h
+//  Naive2D
+//
+//  Contact manifolds between convex polygons, and between a convex polygon
+//  and a sphere: the contact normal and up to two contact points with their
+//  separation (negative when penetrating).
+//  Separated polygons get their normal from the closest points GJK finds.
+//  Overlapping polygons get it from the face of either polygon that
+//  separates the other one the most, which for polygons is exactly the face
+//  EPA would converge to. The contact points come from clipping the incident
+//  edge against the side planes of that reference face. Nothing is
+//  allocated, so it is cheap enough for inner loops.
+//
+//  Reference:
+//      E. Catto, Contact Manifolds, GDC 2007.
+//      https://box2d.org/publications/
+//
+
+#ifndef Naive2D_contact_h
+#define Naive2D_contact_h
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "GJK_utility.h"
+
+namespace N2D {
+
+    struct Contact_manifold
+    {
+        v2 normal;                  // unit normal pointing from a to b
+        v2 points[2];               // contact points on the surface of b
+        double separations[2] = {MAX_DOUBLE, MAX_DOUBLE};   // distance from a to each point along the normal, negative if penetrating
+        unsigned count = 0;         // 0 if the shapes are farther apart than the query distance
+
+        bool touching() const { return count > 0; }
+
+        // the contact point on the surface of a matching points[i]
+        v2 point_on_a( unsigned i ) const { return points[i] - normal * separations[i]; }
+
+        // MAX_DOUBLE if not touching
+        double min_separation() const
+        {
+            if( count == 0 ) return MAX_DOUBLE;
+            return count == 2 ? std::min(separations[0], separations[1]) : separations[0];
+        }
+    };
+
+    namespace contact_detail
+    {
+        // a separated face contact is used when a face normal is within this of the GJK normal (1 - cos)
+        constexpr double ANGULAR_TOLERANCE = 1e-4;
+
+        // +1 if the polygon is counterclockwise, -1 if clockwise
+        static inline double orientation( const Polygon_view& polygon )
+        {
+            double area = 0.0;
+            for(unsigned i = 0; i < polygon.size; i++)
+                area += polygon[i].cross(polygon[(i + 1) % polygon.size]);
+            return area > 0 ? 1.0 : -1.0;
+        }
+
+        // outward unit normal of edge i
+        static inline v2 edge_normal( const Polygon_view& polygon, unsigned i, double orientation )
+        {
+            v2 edge = polygon[(i + 1) % polygon.size] - polygon[i];
+            return v2(edge.y, -edge.x).norm() * orientation;
+        }
+
+        // The edge of a whose outward normal separates b the most. Returns that separation.
+        static inline double max_separation( const Polygon_view& a, double orientation_a, const Polygon_view& b, unsigned& edge )
+        {
+            double best = -MAX_DOUBLE;
+            edge = 0;
+            for(unsigned i = 0; i < a.size; i++)
+            {
+                if( a[(i + 1) % a.size] == a[i] ) continue;
+                v2 normal = edge_normal(a, i, orientation_a);
+                double separation = normal.dot(GJK::farest_point_in_dir(b.vertices, b.size, -normal) - a[i]);
+                if( separation > best )
+                {
+                    best = separation;
+                    edge = i;
+                }
+            }
+            return best;
+        }
+
+        // The edge whose outward normal is the closest to dir. Returns the cosine between them.
+        static inline double best_aligned( const Polygon_view& polygon, double orientation, const v2& dir, unsigned& edge )
+        {
+            double best = -MAX_DOUBLE;
+            edge = 0;
+            for(unsigned i = 0; i < polygon.size; i++)
+            {
+                if( polygon[(i + 1) % polygon.size] == polygon[i] ) continue;
+                double cosine = edge_normal(polygon, i, orientation).dot(dir);
+                if( cosine > best )
+                {
+                    best = cosine;
+                    edge = i;
+                }
+            }
+            return best;
+        }
+
+        // Cuts the part of segment p-q whose projection on axis is below `bound` (above if upper).
+        // Returns false if nothing is left.
+        static inline bool clip_segment( v2& p, v2& q, const v2& axis, double bound, bool upper )
+        {
+            double dp = axis.dot(p) - bound, dq = axis.dot(q) - bound;
+            if( upper ) { dp = -dp; dq = -dq; }
+            if( dp < 0.0 && dq < 0.0 ) return false;
+            if( dp < 0.0 )      p = p + (q - p) * (dp / (dp - dq));
+            else if( dq < 0.0 ) q = q + (p - q) * (dq / (dq - dp));
+            return true;
+        }
+
+        /* Clips the incident edge of `incident` against the side planes of edge `edge` of `reference`.
+         * @param flip: the reference polygon is b, so the normal points the other way and the
+         *              contact points are projected onto the reference face.
+         */
+        static inline Contact_manifold clip( const Polygon_view& reference, double orientation_ref, unsigned edge,
+                                             const Polygon_view& incident, double orientation_inc, bool flip, double max_distance )
+        {
+            Contact_manifold manifold;
+            v2 normal = edge_normal(reference, edge, orientation_ref);
+            const v2& r1 = reference[edge];
+            const v2& r2 = reference[(edge + 1) % reference.size];
+
+            // the incident edge faces the reference edge the most
+            unsigned incident_edge;
+            best_aligned(incident, orientation_inc, -normal, incident_edge);
+            v2 p = incident[incident_edge];
+            v2 q = incident[(incident_edge + 1) % incident.size];
+
+            v2 tangent = (r2 - r1).norm();
+            if( !clip_segment(p, q, tangent, tangent.dot(r1), false) ) return manifold;
+            if( !clip_segment(p, q, tangent, tangent.dot(r2), true) ) return manifold;
+
+            manifold.normal = flip ? -normal : normal;
+            for( const v2& point : {p, q} )
+            {
+                double separation = normal.dot(point - r1);
+                if( separation > max_distance ) continue;
+                manifold.points[manifold.count] = flip ? point - normal * separation : point;
+                manifold.separations[manifold.count] = separation;
+                manifold.count++;
+            }
+            return manifold;
+        }
+    }
+
+    /* Contact manifold of two convex polygons, in either winding order.
+     * @param max_distance: separated polygons closer than this still report contacts
+     *                      (speculative contacts); 0 reports touching and overlapping pairs only.
+     */
+    static inline Contact_manifold contact( const Polygon_view& a, const Polygon_view& b, double max_distance = 0.0 )
+    {
+        using namespace contact_detail;
+        v2 point_a, point_b;
+        double distance = GJK::closest_points(a.vertices, a.size, b.vertices, b.size, point_a, point_b);
+        if( distance > max_distance )
+            return Contact_manifold();
+
+        double orientation_a = orientation(a), orientation_b = orientation(b);
+        unsigned edge_a, edge_b;
+        if( distance > 0.0 )
+        {
+            v2 normal = (point_b - point_a) / distance;
+            double cos_a = best_aligned(a, orientation_a, normal, edge_a);
+            double cos_b = best_aligned(b, orientation_b, -normal, edge_b);
+            if( std::max(cos_a, cos_b) >= 1.0 - ANGULAR_TOLERANCE )
+            {
+                Contact_manifold manifold = cos_a >= cos_b ? clip(a, orientation_a, edge_a, b, orientation_b, false, max_distance)
+                                                           : clip(b, orientation_b, edge_b, a, orientation_a, true, max_distance);
+                // a face can be aligned with two vertices that touch just past its end; then the
+                // closest point is clipped away and this is a vertex contact after all
+                if( manifold.count > 0 && manifold.min_separation() <= distance * (1.0 + ANGULAR_TOLERANCE) )
+                    return manifold;
+            }
+            // vertex against vertex
+            Contact_manifold manifold;
+            manifold.normal = normal;
+            manifold.points[0] = point_b;
+            manifold.separations[0] = distance;
+            manifold.count = 1;
+            return manifold;
+        }
+
+        double separation_a = max_separation(a, orientation_a, b, edge_a);
+        double separation_b = max_separation(b, orientation_b, a, edge_b);
+        // prefer a on ties so that the reference face does not flip between frames
+        if( separation_b > separation_a + GJK::EPSILON )
+            return clip(b, orientation_b, edge_b, a, orientation_a, true, max_distance);
+        return clip(a, orientation_a, edge_a, b, orientation_b, false, max_distance);
+    }
+
+    static inline Contact_manifold contact( const Polygon& a, const Polygon& b, double max_distance = 0.0 )
+    {
+        return contact(a.view(), b.view(), max_distance);
+    }
+
+    /* Contact manifold of a convex polygon and a sphere; at most one point.
+     * L1 and L-infinity spheres are diamonds and squares and are handled as polygons.
+     */
+    static inline Contact_manifold contact( const Polygon_view& a, const sphere& b, double max_distance = 0.0 )
+    {
+        v2 c = b.center();
+        double r = b.radius();
+        if( b.metric == SPHEREMETRIC::L1 )
+        {
+            v2 diamond[4] = {c + v2(-r, 0), c + v2(0, r), c + v2(r, 0), c + v2(0, -r)};
+            return contact(a, Polygon_view(diamond, 4), max_distance);
+        }
+        if( b.metric == SPHEREMETRIC::LINFTY )
+        {
+            v2 square[4] = {c + v2(-r, -r), c + v2(-r, r), c + v2(r, r), c + v2(r, -r)};
+            return contact(a, Polygon_view(square, 4), max_distance);
+        }
+
+        Contact_manifold manifold;
+        if( !a.contains(c) )
+        {
+            v2 closest = a.closest_pt_to(c);
+            double distance = (c - closest).r();
+            if( distance - r > max_distance )
+                return manifold;
+            manifold.normal = (c - closest) / distance;
+            manifold.separations[0] = distance - r;
+        }
+        else
+        {
+            // the center is inside: push it out through the nearest face
+            double orientation = contact_detail::orientation(a);
+            double best = -MAX_DOUBLE;
+            for(unsigned i = 0; i < a.size; i++)
+            {
+                if( a[(i + 1) % a.size] == a[i] ) continue;
+                v2 normal = contact_detail::edge_normal(a, i, orientation);
+                double separation = normal.dot(c - a[i]);
+                if( separation > best )
+                {
+                    best = separation;
+                    manifold.normal = normal;
+                }
+            }
+            manifold.separations[0] = best - r;
+        }
+        manifold.points[0] = c - manifold.normal * r;
+        manifold.count = 1;
+        return manifold;
+    }
+
+    static inline Contact_manifold contact( const Polygon& a, const sphere& b, double max_distance = 0.0 )
+    {
+        return contact(a.view(), b, max_distance);
+    }
+
+    /* Contact manifolds of a robot against every obstacle, in parallel.
+     * @param out: room for obstacles.size() manifolds, out[i] is for obstacles[i]
+     */
+    static inline void contacts( const Polygon_view& robot, const std::vector<Polygon>& obstacles, double max_distance, Contact_manifold* out )
+    {
+        int n = (int)obstacles.size();
+        #pragma omp parallel for schedule(static)
+        for( int i = 0; i < n; i++ )
+            out[i] = contact(robot, obstacles[i].view(), max_distance);
+    }
+
+    /* Contact manifolds of many pairs of polygons, e.g. the pairs a broad phase reported, in parallel.
+     * @param out: room for pairs.size() manifolds, out[i] is for polygons[pairs[i].first] against polygons[pairs[i].second]
+     */
+    static inline void contacts( const std::vector<Polygon>& polygons, const std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+                                 double max_distance, Contact_manifold* out )
+    {
+        int n = (int)pairs.size();
+        #pragma omp parallel for schedule(static)
+        for( int i = 0; i < n; i++ )
+            out[i] = contact(polygons[pairs[i].first].view(), polygons[pairs[i].second].view(), max_distance);
+    }
+}
+
+#endif
@@ -0,0 +1,314 @@
+//
+//  differential.h
+//  Naive2D
+//
+//  Differential testing of the fast queries against their reference
+//  implementations, e.g. GJK intersects against naive_intersects. Each case
+//  is generated from its own seed, so every disagreement can be replayed
+//  alone, and both methods are timed on the same cases. differential_suite
+//  runs every fast/reference pair of the library; new fast paths should add
+//  theirs there.
+//
+
+#ifndef Naive2D_differential_h
+#define Naive2D_differential_h
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "fixed_polygon.h"
+#include "contact.h"
+#include "edge_bvh.h"
+#include "predicates.h"
+#include "scene_generator.h"
+
+namespace N2D {
+
+    struct Differential_report
+    {
+        const char* name = "";
+        size_t cases = 0;
+        size_t disagreements = 0;
+        double fast_ns = 0.0, reference_ns = 0.0;  // per case
+        std::vector<uint64_t> seeds;                // of the first disagreeing cases
+    };
+
+    static inline std::ostream& operator<<( std::ostream& out, const Differential_report& report )
+    {
+        out << std::left << std::setw(36) << report.name << std::right << std::setw(9) << report.cases << " cases, "
+            << std::setw(6) << report.disagreements << " disagreements, "
+            << std::fixed << std::setprecision(1) << std::setw(8) << report.fast_ns << " ns vs " << std::setw(8) << report.reference_ns << " ns"
+            << std::defaultfloat;
+        if( !report.seeds.empty() )
+        {
+            out << "\n    seeds:" << std::hex;
+            for( uint64_t seed : report.seeds ) out << " 0x" << seed;
+            out << std::dec;
+        }
+        return out;
+    }
+
+    class Differential_harness
+    {
+    public:
+        /* @param seed: the seed of the whole run; case i is generated from Scene_generator::case_seed(seed, i)
+         * @param max_seeds: how many disagreeing seeds each report keeps
+         */
+        explicit Differential_harness( uint64_t seed, size_t max_seeds = 8 ) : seed(seed), max_seeds(max_seeds) {}
+
+        /* Runs both methods on the same cases and counts the cases they disagree on.
+         * @param make: Case make(Scene_generator&), builds one case from the generator
+         * @param fast, reference: Result f(const Case&)
+         * @param agree: bool agree(fast result, reference result)
+         */
+        template <class Make, class Fast, class Reference, class Agree>
+        const Differential_report& run( const char* name, size_t cases, const Make& make, const Fast& fast, const Reference& reference, const Agree& agree )
+        {
+            typedef decltype(make(std::declval<Scene_generator&>())) Case;
+            typedef decltype(fast(std::declval<const Case&>())) Fast_result;
+            typedef decltype(reference(std::declval<const Case&>())) Reference_result;
+            using clock = std::chrono::steady_clock;
+
+            Differential_report report;
+            report.name = name;
+            double fast_total = 0.0, reference_total = 0.0;
+            // the methods are timed a batch at a time, so the timer does not dominate cheap queries
+            const size_t BATCH = 1024;
+            std::vector<Case> batch;
+            std::vector<Fast_result> fast_results;
+            std::vector<Reference_result> reference_results;
+            for( size_t first = 0; first < cases; first += BATCH )
+            {
+                size_t n = std::min(BATCH, cases - first);
+                batch.clear();
+                for( size_t i = 0; i < n; i++ )
+                {
+                    Scene_generator generator(Scene_generator::case_seed(seed, first + i));
+                    batch.push_back(make(generator));
+                }
+
+                fast_results.resize(n);
+                reference_results.resize(n);
+                auto start = clock::now();
+                for( size_t i = 0; i < n; i++ ) fast_results[i] = fast(batch[i]);
+                auto middle = clock::now();
+                for( size_t i = 0; i < n; i++ ) reference_results[i] = reference(batch[i]);
+                auto end = clock::now();
+                fast_total += std::chrono::duration<double, std::nano>(middle - start).count();
+                reference_total += std::chrono::duration<double, std::nano>(end - middle).count();
+
+                for( size_t i = 0; i < n; i++ )
+                {
+                    if( agree(fast_results[i], reference_results[i]) ) continue;
+                    report.disagreements++;
+                    if( report.seeds.size() < max_seeds )
+                        report.seeds.push_back(Scene_generator::case_seed(seed, first + i));
+                }
+            }
+            report.cases = cases;
+            report.fast_ns = cases ? fast_total / cases : 0.0;
+            report.reference_ns = cases ? reference_total / cases : 0.0;
+            reports.push_back(report);
+            return reports.back();
+        }
+
+        // Builds the case a reported seed stands for again, e.g. to debug it.
+        template <class Make>
+        static auto replay( uint64_t case_seed, const Make& make )
+        {
+            Scene_generator generator(case_seed);
+            return make(generator);
+        }
+
+        const std::vector<Differential_report>& results() const { return reports; }
+
+        size_t disagreements() const
+        {
+            size_t total = 0;
+            for( const Differential_report& report : reports ) total += report.disagreements;
+            return total;
+        }
+
+    private:
+        uint64_t seed;
+        size_t max_seeds;
+        std::vector<Differential_report> reports;
+    };
+
+    namespace reference
+    {
+        // Points on the boundary are contained. Any winding.
+        static inline bool contains_convex( const Polygon_view& polygon, const v2& point )
+        {
+            bool left = false, right = false;
+            for(unsigned i = 0; i < polygon.size; i++)
+            {
+                const v2& a = polygon[i]; const v2& b = polygon[(i + 1) % polygon.size];
+                double o = predicates::orient2d(a.x, a.y, b.x, b.y, point.x, point.y);
+                left = left || o > 0.0;
+                right = right || o < 0.0;
+            }
+            return !(left && right);
+        }
+
+        // Nonzero winding number, with exact orientation tests. Points on the boundary are contained.
+        static inline bool contains_winding( const Polygon_view& polygon, const v2& point )
+        {
+            int winding = 0;
+            for(unsigned i = 0; i < polygon.size; i++)
+            {
+                const v2& a = polygon[i]; const v2& b = polygon[(i + 1) % polygon.size];
+                double o = predicates::orient2d(a.x, a.y, b.x, b.y, point.x, point.y);
+                if( o == 0.0 && predicates::in_box(a.x, a.y, b.x, b.y, point.x, point.y) )
+                    return true;
+                if( a.y <= point.y && b.y > point.y && o > 0.0 ) winding++;
+                if( a.y > point.y && b.y <= point.y && o < 0.0 ) winding--;
+            }
+            return winding != 0;
+        }
+
+        // The distance from a sphere of any metric to a polygon, 0 if they overlap.
+        static inline double distance( const Polygon_view& polygon, const sphere& s )
+        {
+            v2 c = s.center();
+            double r = s.radius();
+            if( s.metric == SPHEREMETRIC::L2 )
+                return std::max(0.0, polygon.distance_to(c) - r);
+            std::vector<v2> corners = s.metric == SPHEREMETRIC::L1 ? std::vector<v2>{c + v2(-r, 0), c + v2(0, r), c + v2(r, 0), c + v2(0, -r)}
+                                                                   : std::vector<v2>{c + v2(-r, -r), c + v2(-r, r), c + v2(r, r), c + v2(r, -r)};
+            return polygon.naive_distance_to(Polygon_view(corners.data(), 4));
+        }
+    }
+
+    // results of two distance computations agree up to the tolerance, relative to the larger one beyond 1
+    static inline bool close( double a, double b, double tolerance = 1e-6 )
+    {
+        return std::fabs(a - b) <= tolerance * std::max(1.0, std::max(std::fabs(a), std::fabs(b)));
+    }
+
+    /* Every fast query of the library against its reference, `cases` random cases each.
+     * Returns the number of disagreements of the harness so far; the reports are in harness.results().
+     */
+    static inline size_t differential_suite( Differential_harness& harness, size_t cases )
+    {
+        auto same = [](bool a, bool b){ return a == b; };
+        auto close_enough = [](double a, double b){ return close(a, b); };
+
+        // a convex polygon and a point around it
+        auto convex_and_point = [](Scene_generator& g){
+            Polygon polygon = g.random_convex(v2(0, 0), g.uniform(0.1, 100.0), g.integer(3, 16));
+            AABB box = polygon.bounds();
+            box.expand(box.min - (box.max - box.min) * 0.25);
+            box.expand(box.max + (box.max - box.min) * 0.25);
+            return std::make_pair(std::move(polygon), g.random_point(box));
+        };
+        harness.run("contains, convex", cases, convex_and_point,
+                    [](const std::pair<Polygon, v2>& c){ return c.first.contains(c.second); },
+                    [](const std::pair<Polygon, v2>& c){ return reference::contains_convex(c.first.view(), c.second); }, same);
+
+        auto star_and_point = [](Scene_generator& g){
+            Polygon polygon = g.random_star(v2(0, 0), g.uniform(0.1, 100.0), g.integer(3, 64));
+            return std::make_pair(std::move(polygon), g.random_point(polygon.bounds()));
+        };
+        harness.run("contains, non-convex", cases, star_and_point,
+                    [](const std::pair<Polygon, v2>& c){ return c.first.contains(c.second); },
+                    [](const std::pair<Polygon, v2>& c){ return reference::contains_winding(c.first.view(), c.second); }, same);
+
+        // two convex polygons whose distance is about their size, so about half of them overlap
+        auto convex_pair = [](Scene_generator& g){
+            double r1 = g.uniform(0.1, 100.0), r2 = g.uniform(0.1, 100.0);
+            double angle = g.uniform(0.0, 2 * PI), distance = (r1 + r2) * g.uniform(0.0, 1.2);
+            return std::make_pair(g.random_convex(v2(0, 0), r1, g.integer(3, 16)),
+                                  g.random_convex(v2(distance * std::cos(angle), distance * std::sin(angle)), r2, g.integer(3, 16)));
+        };
+        harness.run("intersects, GJK vs naive", cases, convex_pair,
+                    [](const std::pair<Polygon, Polygon>& c){ return c.first.intersects(c.second); },
+                    [](const std::pair<Polygon, Polygon>& c){ return c.first.naive_intersects(c.second); }, same);
+        harness.run("distance, GJK vs naive", cases, convex_pair,
+                    [](const std::pair<Polygon, Polygon>& c){ return c.first.distance_to(c.second); },
+                    [](const std::pair<Polygon, Polygon>& c){ return c.first.naive_distance_to(c.second); }, close_enough);
+
+        auto fixed_pair = [](Scene_generator& g){
+            Polygon a = g.random_convex(v2(0, 0), 1.0, 3), b = g.random_convex(v2(g.uniform(-2, 2), g.uniform(-2, 2)), 1.0, 4);
+            return std::make_pair(Triangle(a.vertices[0], a.vertices[1], a.vertices[2]), Quad(b.vertices[0], b.vertices[1], b.vertices[2], b.vertices[3]));
+        };
+        harness.run("intersects, fixed GJK vs naive", cases, fixed_pair,
+                    [](const std::pair<Triangle, Quad>& c){ return c.first.intersects(c.second); },
+                    [](const std::pair<Triangle, Quad>& c){ return c.first.view().naive_intersects(c.second.view()); }, same);
+        harness.run("intersects, fixed SAT vs naive", cases, fixed_pair,
+                    [](const std::pair<Triangle, Quad>& c){ return SAT::intersects(c.first, c.second); },
+                    [](const std::pair<Triangle, Quad>& c){ return c.first.view().naive_intersects(c.second.view()); }, same);
+
+        // a segment is a convex polygon with 2 vertices for GJK
+        auto convex_and_segment = [](Scene_generator& g){
+            Polygon polygon = g.random_convex(v2(0, 0), g.uniform(0.1, 100.0), g.integer(3, 16));
+            AABB box = polygon.bounds();
+            double size = (box.max - box.min).r();
+            box.expand(box.min - (box.max - box.min) * 0.5);
+            box.expand(box.max + (box.max - box.min) * 0.5);
+            return std::make_pair(std::move(polygon), g.random_segment(box, size));
+        };
+        harness.run("intersects segment, GJK vs naive", cases, convex_and_segment,
+                    [](const std::pair<Polygon, Line_segment>& c){
+                        v2 segment[2] = {c.second.start, c.second.end};
+                        return GJK::intersects(c.first.vertices.data(), (unsigned)c.first.vertices.size(), segment, 2);
+                    },
+                    [](const std::pair<Polygon, Line_segment>& c){ return c.first.intersects(c.second); }, same);
+
+        // two non-convex polygons, some of them nested
+        auto star_pair = [](Scene_generator& g){
+            double r1 = g.uniform(0.1, 100.0), r2 = g.uniform(0.1, 100.0);
+            double angle = g.uniform(0.0, 2 * PI), distance = (r1 + r2) * g.uniform(0.0, 1.2);
+            return std::make_pair(g.random_star(v2(0, 0), r1, g.integer(3, 200)),
+                                  g.random_star(v2(distance * std::cos(angle), distance * std::sin(angle)), r2, g.integer(3, 200)));
+        };
+        harness.run("intersects, edge BVH vs naive", cases, star_pair,
+                    [](const std::pair<Polygon, Polygon>& c){ return Edge_bvh(c.first.view()).intersects(Edge_bvh(c.second.view())); },
+                    [](const std::pair<Polygon, Polygon>& c){ return c.first.naive_intersects(c.second); }, same);
+        harness.run("distance, edge BVH vs naive", cases, star_pair,
+                    [](const std::pair<Polygon, Polygon>& c){ return Edge_bvh(c.first.view()).distance_to(Edge_bvh(c.second.view())); },
+                    [](const std::pair<Polygon, Polygon>& c){ return c.first.naive_distance_to(c.second); }, close_enough);
+
+        auto star_and_segment = [](Scene_generator& g){
+            Polygon polygon = g.random_star(v2(0, 0), g.uniform(0.1, 100.0), g.integer(3, 200));
+            AABB box = polygon.bounds();
+            double size = (box.max - box.min).r();
+            box.expand(box.min - (box.max - box.min) * 0.5);
+            box.expand(box.max + (box.max - box.min) * 0.5);
+            return std::make_pair(std::move(polygon), g.random_segment(box, size));
+        };
+        harness.run("intersects segment, edge BVH vs naive", cases, star_and_segment,
+                    [](const std::pair<Polygon, Line_segment>& c){ return Edge_bvh(c.first.view()).intersects(c.second); },
+                    [](const std::pair<Polygon, Line_segment>& c){ return c.first.intersects(c.second); }, same);
+        harness.run("distance segment, edge BVH vs naive", cases, star_and_segment,
+                    [](const std::pair<Polygon, Line_segment>& c){ return Edge_bvh(c.first.view()).distance_to(c.second); },
+                    [](const std::pair<Polygon, Line_segment>& c){ return c.first.distance_to(c.second); }, close_enough);
+
+        auto convex_and_sphere = [](Scene_generator& g){
+            double r1 = g.uniform(0.1, 100.0), r2 = g.uniform(0.1, 100.0);
+            double angle = g.uniform(0.0, 2 * PI), distance = (r1 + r2) * g.uniform(0.0, 1.2);
+            return std::make_pair(g.random_convex(v2(0, 0), r1, g.integer(3, 16)),
+                                  g.random_sphere(v2(distance * std::cos(angle), distance * std::sin(angle)), r2));
+        };
+        harness.run("sphere distance, contact vs naive", cases, convex_and_sphere,
+                    [](const std::pair<Polygon, sphere>& c){
+                        // a missing manifold reads as infinitely far, so it counts as a disagreement
+                        Contact_manifold manifold = contact(c.first, c.second, MAX_DOUBLE);
+                        return manifold.touching() ? std::max(0.0, manifold.min_separation()) : MAX_DOUBLE;
+                    },
+                    [](const std::pair<Polygon, sphere>& c){ return reference::distance(c.first.view(), c.second); },
+                    // a separated face contact only has to be aligned with the closest points up to the angular tolerance
+                    [](double a, double b){ return close(a, b, contact_detail::ANGULAR_TOLERANCE); });
+
+        return harness.disagreements();
+    }
+}
+
+#endif
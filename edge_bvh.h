@@ -0,0 +1,316 @@
+//
+//  edge_bvh.h
+//  Naive2D
+//
+//  A bounding volume hierarchy over the edges of one polygon, for distance
+//  and intersection queries between large non-convex polygons. The naive
+//  methods test every edge against every edge. Two trees are instead walked
+//  together (dual-tree traversal): a pair of nodes is only opened if their
+//  boxes overlap, or, for distances, if their boxes are closer than the best
+//  distance found so far (branch and bound). The answers are those of the
+//  naive methods; only the edge pairs that cannot matter are skipped.
+//
+//  Reference:
+//      C. Ericson, Real-Time Collision Detection, chapter 6.
+//
+
+#ifndef Naive2D_edge_bvh_h
+#define Naive2D_edge_bvh_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    class Edge_bvh
+    {
+    public:
+        // edges per leaf
+        static constexpr unsigned LEAF_SIZE = 4;
+
+        /* Builds the tree over the edges of polygon, which may be non-convex.
+         * The tree keeps pointing at the polygon's vertices, so they must stay where they are.
+         */
+        explicit Edge_bvh( const Polygon_view& polygon ) : polygon(polygon)
+        {
+            if( polygon.size < 2 )
+                throw "An edge BVH needs at least 2 vertices.";
+            std::vector<Item> items(polygon.size);
+            for( uint32_t i = 0; i < polygon.size; i++ )
+                items[i] = Item{(polygon[i] + polygon[next(i)]) * 0.5, i};
+            // leaves hold at least LEAF_SIZE / 2 edges
+            nodes.reserve(4 * polygon.size / LEAF_SIZE + 1);
+            nodes.emplace_back();
+            build(items, 0, 0, polygon.size);
+            edges.resize(polygon.size);
+            for( uint32_t i = 0; i < polygon.size; i++ ) edges[i] = items[i].edge;
+        }
+
+        const Polygon_view& view() const { return polygon; }
+
+        const AABB& bounds() const { return nodes[0].box; }
+
+        size_t node_count() const { return nodes.size(); }
+
+        // Same rule as Polygon_view::contains, only the edges whose boxes reach the ray are visited.
+        bool contains( const v2& point ) const
+        {
+            bool inside = false;
+            uint32_t stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while( top > 0 )
+            {
+                const Node& node = nodes[stack[--top]];
+                if( point.y < node.box.min.y || point.y > node.box.max.y || point.x > node.box.max.x ) continue;
+                if( !node.leaf() )
+                {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                    continue;
+                }
+                for( uint32_t k = node.first; k < node.first + node.count; k++ )
+                {
+                    const v2& a = polygon[edges[k]];
+                    const v2& b = polygon[next(edges[k])];
+                    bool a_above = a.y > point.y, b_above = b.y > point.y;
+                    bool in_y_range = a_above != b_above || a.y == point.y || b.y == point.y;
+                    if( !in_y_range || point.x > std::max(a.x, b.x) )
+                        continue;
+                    double o = predicates::orient2d(a.x, a.y, b.x, b.y, point.x, point.y);
+                    if( o == 0.0 && predicates::in_box(a.x, a.y, b.x, b.y, point.x, point.y) )
+                        return true;
+                    if( a_above != b_above && (b_above ? o > 0.0 : o < 0.0) )
+                        inside = !inside;
+                }
+            }
+            return inside;
+        }
+
+        // Same answer as Polygon_view::intersects(line).
+        bool intersects( const Line_segment& line ) const
+        {
+            AABB box;
+            box.expand(line.start);
+            box.expand(line.end);
+            uint32_t stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while( top > 0 )
+            {
+                const Node& node = nodes[stack[--top]];
+                if( !node.box.overlaps(box) ) continue;
+                if( !node.leaf() )
+                {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                    continue;
+                }
+                for( uint32_t k = node.first; k < node.first + node.count; k++ )
+                    if( edge(edges[k]).intersects(line) ) return true;
+            }
+            // no edge is crossed, so the segment is completely inside or completely outside
+            return contains(line.start);
+        }
+
+        // Same answer as Polygon_view::distance_to(line).
+        double distance_to( const Line_segment& line ) const
+        {
+            AABB box;
+            box.expand(line.start);
+            box.expand(line.end);
+            double best = MAX_DOUBLE;
+            std::pair<double, uint32_t> stack[64];
+            int top = 0;
+            stack[top++] = std::make_pair(0.0, 0u);
+            while( top > 0 )
+            {
+                std::pair<double, uint32_t> entry = stack[--top];
+                if( entry.first >= best * best ) continue;
+                const Node& node = nodes[entry.second];
+                if( node.leaf() )
+                {
+                    for( uint32_t k = node.first; k < node.first + node.count; k++ )
+                        best = std::min(best, edge(edges[k]).dist_to_line_seg(line));
+                    if( best == 0.0 ) return 0.0;
+                    continue;
+                }
+                // the nearer child goes on top
+                double d1 = box_distance_squared(nodes[node.first].box, box), d2 = box_distance_squared(nodes[node.first + 1].box, box);
+                if( d1 <= d2 )
+                {
+                    stack[top++] = std::make_pair(d2, node.first + 1);
+                    stack[top++] = std::make_pair(d1, node.first);
+                }
+                else
+                {
+                    stack[top++] = std::make_pair(d1, node.first);
+                    stack[top++] = std::make_pair(d2, node.first + 1);
+                }
+            }
+            return best;
+        }
+
+        // Same answer as Polygon_view::naive_intersects(other).
+        bool intersects( const Edge_bvh& other ) const
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> stack;
+            stack.emplace_back(0, 0);
+            while( !stack.empty() )
+            {
+                std::pair<uint32_t, uint32_t> pair = stack.back();
+                stack.pop_back();
+                const Node& a = nodes[pair.first];
+                const Node& b = other.nodes[pair.second];
+                if( !a.box.overlaps(b.box) ) continue;
+                if( a.leaf() && b.leaf() )
+                {
+                    for( uint32_t i = a.first; i < a.first + a.count; i++ )
+                    {
+                        Line_segment ea = edge(edges[i]);
+                        for( uint32_t j = b.first; j < b.first + b.count; j++ )
+                            if( ea.intersects(other.edge(other.edges[j])) ) return true;
+                    }
+                }
+                else if( descend_first(a, b) )
+                {
+                    stack.emplace_back(a.first, pair.second);
+                    stack.emplace_back(a.first + 1, pair.second);
+                }
+                else
+                {
+                    stack.emplace_back(pair.first, b.first);
+                    stack.emplace_back(pair.first, b.first + 1);
+                }
+            }
+            // the boundaries do not touch: either one polygon lies inside the other or they are apart
+            return contains(other.polygon[0]) || other.contains(polygon[0]);
+        }
+
+        // Same answer as Polygon_view::naive_distance_to(other).
+        double distance_to( const Edge_bvh& other ) const
+        {
+            if( contains(other.polygon[0]) || other.contains(polygon[0]) )
+                return 0.0;
+            double best = MAX_DOUBLE;
+            struct Entry { double distance; uint32_t a, b; };
+            std::vector<Entry> stack;
+            stack.push_back(Entry{0.0, 0, 0});
+            while( !stack.empty() )
+            {
+                Entry entry = stack.back();
+                stack.pop_back();
+                if( entry.distance >= best * best ) continue;
+                const Node& a = nodes[entry.a];
+                const Node& b = other.nodes[entry.b];
+                if( a.leaf() && b.leaf() )
+                {
+                    for( uint32_t i = a.first; i < a.first + a.count; i++ )
+                    {
+                        Line_segment ea = edge(edges[i]);
+                        for( uint32_t j = b.first; j < b.first + b.count; j++ )
+                            best = std::min(best, ea.dist_to_line_seg(other.edge(other.edges[j])));
+                    }
+                    if( best == 0.0 ) return 0.0;
+                    continue;
+                }
+                Entry first, second;
+                if( descend_first(a, b) )
+                {
+                    first  = Entry{box_distance_squared(nodes[a.first].box, b.box), a.first, entry.b};
+                    second = Entry{box_distance_squared(nodes[a.first + 1].box, b.box), a.first + 1, entry.b};
+                }
+                else
+                {
+                    first  = Entry{box_distance_squared(a.box, other.nodes[b.first].box), entry.a, b.first};
+                    second = Entry{box_distance_squared(a.box, other.nodes[b.first + 1].box), entry.a, b.first + 1};
+                }
+                // the nearer pair goes on top
+                if( first.distance > second.distance ) std::swap(first, second);
+                stack.push_back(second);
+                stack.push_back(first);
+            }
+            return best;
+        }
+
+    private:
+        // A leaf holds edges[first .. first + count); an inner node has count 0 and its children at first and first + 1.
+        struct Node
+        {
+            AABB box;
+            uint32_t first = 0, count = 0;
+            bool leaf() const { return count > 0; }
+        };
+
+        Polygon_view polygon;
+        std::vector<Node> nodes;
+        std::vector<uint32_t> edges;    // edge i goes from vertex i to vertex i + 1
+
+        uint32_t next( uint32_t i ) const { return i + 1 == polygon.size ? 0 : i + 1; }
+
+        Line_segment edge( uint32_t i ) const { return Line_segment(polygon[i], polygon[next(i)]); }
+
+        // an edge while the tree is built
+        struct Item
+        {
+            v2 center;
+            uint32_t edge;
+        };
+
+        // Splits the edges at the median of their midpoints along the longer side of the box.
+        void build( std::vector<Item>& items, uint32_t index, uint32_t begin, uint32_t end )
+        {
+            AABB box, centers;
+            for( uint32_t k = begin; k < end; k++ )
+            {
+                box.expand(polygon[items[k].edge]);
+                box.expand(polygon[next(items[k].edge)]);
+                centers.expand(items[k].center);
+            }
+            nodes[index].box = box;
+            if( end - begin <= LEAF_SIZE )
+            {
+                nodes[index].first = begin;
+                nodes[index].count = end - begin;
+                return;
+            }
+
+            bool along_x = centers.max.x - centers.min.x >= centers.max.y - centers.min.y;
+            uint32_t middle = begin + (end - begin) / 2;
+            std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [&](const Item& a, const Item& b){
+                return along_x ? a.center.x < b.center.x : a.center.y < b.center.y;
+            });
+
+            uint32_t children = (uint32_t)nodes.size();
+            nodes[index].first = children;
+            nodes.emplace_back();
+            nodes.emplace_back();
+            build(items, children, begin, middle);
+            build(items, children + 1, middle, end);
+        }
+
+        // open the larger of two nodes first, unless it is a leaf
+        static bool descend_first( const Node& a, const Node& b )
+        {
+            if( a.leaf() ) return false;
+            if( b.leaf() ) return true;
+            v2 sa = a.box.max - a.box.min, sb = b.box.max - b.box.min;
+            return sa.x + sa.y >= sb.x + sb.y;
+        }
+
+        static double box_distance_squared( const AABB& a, const AABB& b )
+        {
+            double dx = std::max(0.0, std::max(a.min.x - b.max.x, b.min.x - a.max.x));
+            double dy = std::max(0.0, std::max(a.min.y - b.max.y, b.min.y - a.max.y));
+            return dx * dx + dy * dy;
+        }
+    };
+}
+
+#endif
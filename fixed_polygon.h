@@ -0,0 +1,159 @@
+//
+//  fixed_polygon.h
+//  Naive2D
+//
+//  Polygons whose number of vertices is known at compile time, e.g. the
+//  triangles and rectangles most robots and obstacles are made of. The
+//  vertices live in a std::array, so there is no allocation, and the support
+//  function GJK calls is fully unrolled. A Fixed_polygon can be viewed as a
+//  Polygon_view for every other Polygon query.
+//
+
+#ifndef Naive2D_fixed_polygon_h
+#define Naive2D_fixed_polygon_h
+
+#include <array>
+#include <cmath>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "GJK_utility.h"
+
+namespace N2D {
+
+    template <size_t N>
+    struct Fixed_polygon
+    {
+        static_assert(N >= 3, "a polygon needs at least 3 vertices");
+
+        std::array<v2, N> vertices;
+
+        // Please make sure the order of these points are clockwise.
+        constexpr explicit Fixed_polygon( const std::array<v2, N>& points ) : vertices(points) {}
+
+        // Please make sure the order of these points are clockwise.
+        // e.g. constexpr Fixed_polygon<3> triangle(v2(0, 0), v2(0, 1), v2(1, 0));
+        template <class... Points>
+        constexpr explicit Fixed_polygon( const v2& first, const Points&... rest ) : vertices{{first, rest...}}
+        {
+            static_assert(sizeof...(Points) + 1 == N, "wrong number of vertices");
+        }
+
+        constexpr size_t size() const { return N; }
+
+        Polygon_view view() const { return Polygon_view(vertices.data(), (unsigned)N); }
+
+        Polygon to_polygon() const { return Polygon(vertices.data(), (int)N); }
+
+        // translate.
+        constexpr void self_translate( const v2& vect )
+        {
+            for(size_t i = 0; i < N; i++)
+                vertices[i] += vect;
+        }
+
+        // rotate self.
+        void self_rotate( double dtheta, const v2& center )
+        {
+            double cos_dtheta = cos(dtheta);
+            double sin_dtheta = sin(dtheta);
+            for(size_t i = 0; i < N; i++)
+            {
+                v2 temp = vertices[i]-center;
+                vertices[i].x = ( temp.x * cos_dtheta - temp.y * sin_dtheta ) + center.x;
+                vertices[i].y = ( temp.x * sin_dtheta + temp.y * cos_dtheta ) + center.y;
+            }
+        }
+
+        AABB bounds() const
+        {
+            AABB box;
+            for(size_t i = 0; i < N; i++)
+                box.expand(vertices[i]);
+            return box;
+        }
+
+        bool contains( const v2& point ) const { return view().contains(point); }
+
+        bool intersects( const Line_segment& line ) const { return view().intersects(line); }
+
+        // GJK with unrolled support functions. Both polygons have to be convex.
+        template <size_t M>
+        bool intersects( const Fixed_polygon<M>& other ) const { return GJK::intersects(vertices, other.vertices); }
+
+        bool intersects( const Polygon_view& other ) const
+        {
+            return GJK::intersects_support([&](const v2& dir){
+                return GJK::farest_point_in_dir(vertices, dir) - GJK::farest_point_in_dir(other.vertices, other.size, -dir);
+            });
+        }
+
+        bool intersects( const Polygon& other ) const { return intersects(other.view()); }
+
+        template <size_t M>
+        double distance_to( const Fixed_polygon<M>& other ) const
+        {
+            if( intersects(other) ) return 0.0;
+            return GJK::distance(vertices, other.vertices);
+        }
+
+        double distance_to( const Polygon_view& other ) const
+        {
+            if( intersects(other) ) return 0.0;
+            return GJK::distance_support([&](const v2& dir){
+                return GJK::farest_point_in_dir(vertices, dir) - GJK::farest_point_in_dir(other.vertices, other.size, -dir);
+            });
+        }
+
+        double distance_to( const Polygon& other ) const { return distance_to(other.view()); }
+
+        double distance_to( const v2& point ) const { return view().distance_to(point); }
+    };
+
+    namespace SAT
+    {
+        // min and max of the projection of the vertices onto axis
+        template <size_t N>
+        static inline void project( const std::array<v2, N>& points, const v2& axis, double& min, double& max )
+        {
+            min = max = points[0].dot(axis);
+            for(size_t i = 1; i < N; i++)
+            {
+                double d = points[i].dot(axis);
+                min = std::min(min, d);
+                max = std::max(max, d);
+            }
+        }
+
+        // true if one of the edge normals of `edges` separates a and b
+        template <size_t N, size_t M, size_t K>
+        static inline bool separated_by_edges_of( const std::array<v2, K>& edges, const std::array<v2, N>& a, const std::array<v2, M>& b )
+        {
+            for(size_t i = 0; i < K; i++)
+            {
+                v2 edge = edges[(i + 1) % K] - edges[i];
+                v2 axis(-edge.y, edge.x);
+                double min_a, max_a, min_b, max_b;
+                project(a, axis, min_a, max_a);
+                project(b, axis, min_b, max_b);
+                if( max_a < min_b || max_b < min_a )
+                    return true;
+            }
+            return false;
+        }
+
+        /* Separating axis test for two convex fixed size polygons. All loops have
+         * compile time bounds and get unrolled. Touching polygons intersect.
+         */
+        template <size_t N, size_t M>
+        static inline bool intersects( const Fixed_polygon<N>& a, const Fixed_polygon<M>& b )
+        {
+            return !separated_by_edges_of(a.vertices, a.vertices, b.vertices) && !separated_by_edges_of(b.vertices, a.vertices, b.vertices);
+        }
+    }
+
+    typedef Fixed_polygon<3> Triangle;
+    typedef Fixed_polygon<4> Quad;
+}
+
+#endif
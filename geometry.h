@@ -17,7 +17,10 @@
 #include <limits>
 #include <array>
 
+#include "predicates.h"
+
 static constexpr double MAX_DOUBLE = std::numeric_limits<double>::infinity();
+static constexpr double PI = 3.14159265358979323846;
 
 namespace N2D
 {
@@ -29,30 +32,30 @@ namespace N2D
         double x, y;
 
         // Constructor
-        explicit v2(double x_ = 0, double y_ = 0) : x(x_), y(y_) {}
+        constexpr explicit v2(double x_ = 0, double y_ = 0) : x(x_), y(y_) {}
 
         // Plus
-        v2 operator+(const v2 &b) const { return v2(this->x+b.x, this->y+b.y); }
+        constexpr v2 operator+(const v2 &b) const { return v2(this->x+b.x, this->y+b.y); }
 
         // +=
-        v2& operator+=(const v2 &b) { this->x+= b.x; this->y+=b.y; return *this; }
+        constexpr v2& operator+=(const v2 &b) { this->x+= b.x; this->y+=b.y; return *this; }
 
         // Minus
-        v2 operator-(const v2 &b) const {return v2(this->x-b.x, this->y-b.y);}
+        constexpr v2 operator-(const v2 &b) const {return v2(this->x-b.x, this->y-b.y);}
 
         // Unary Minus
-        v2 operator-() const {return v2(-(this->x), -(this->y));}
+        constexpr v2 operator-() const {return v2(-(this->x), -(this->y));}
 
         // -=
-        v2& operator-=(const v2 &b) { this->x-= b.x; this->y-=b.y; return *this;}
+        constexpr v2& operator-=(const v2 &b) { this->x-= b.x; this->y-=b.y; return *this;}
 
         // times a T "b".  a*b = v2( a.x*b, a.y*b, a.z*b )
-        v2 operator*(double b) const {return v2(this->x*b,  this->y*b);}
+        constexpr v2 operator*(double b) const {return v2(this->x*b,  this->y*b);}
 
         //v2 operator*(v2 b) const {return v2(x*b.x, y*b.y );}
 
         // *=
-        v2& operator*=(double b) { this->x*= b; this->y*=b; return *this;}
+        constexpr v2& operator*=(double b) { this->x*= b; this->y*=b; return *this;}
 
         // devided by a T "b".  a/b = v2( a.x/b, a.y/b, a.z/b )
         v2 operator/(double b) const {return v2(*this) *= 1/b; }
@@ -60,9 +63,9 @@ namespace N2D
         // /=
         v2& operator/=(double b) { return *this *= (1/b); }
 
-        bool operator==( const v2 &other ) const { return this->x == other.x && this->y == other.y; }
+        constexpr bool operator==( const v2 &other ) const { return this->x == other.x && this->y == other.y; }
 
-        bool operator!=( const v2 &other ) const { return this->x != other.x || this->y != other.y; }
+        constexpr bool operator!=( const v2 &other ) const { return this->x != other.x || this->y != other.y; }
 
         // multiply a.mult(b) = ( a.x*b.x, a.y*b.y, a.z*b.z )
         //v2 mult( const v2 &b ) const {return v2(x*b.x, y*b.y, z*b.z );}
@@ -72,9 +75,9 @@ namespace N2D
         v2 norm() const { return v2(*this) * (1/r()); }
 
         // dot product
-        double dot(const v2 &b) const { return x*b.x + y*b.y; }
+        constexpr double dot(const v2 &b) const { return x*b.x + y*b.y; }
 
-        double cross(const v2&b) const { return x * b.y - y * b.x; }
+        constexpr double cross(const v2&b) const { return x * b.y - y * b.x; }
 
         // corss product
         //v2 cross( v2 &b ){return v2(y*b.z-z*b.y,z*b.x-x*b.z,x*b.y-y*b.x);} // Cross;
@@ -82,7 +85,7 @@ namespace N2D
         // get the length of the vector
         double r() const { return sqrt( this->dot(*this) ); }
 
-        double rsq() const { return this->dot(*this); }
+        constexpr double rsq() const { return this->dot(*this); }
 
         double l1() const { return fabs(x)+fabs(y); }
 
@@ -153,15 +156,16 @@ namespace N2D
             return start + ab * std::max( 0.0, std::min((pt - start).dot(ab) / ab.rsq(), 1.0));
         }
 
-        // determine if three points are listed in a counterclockwise order
-        bool __ccw__( const v2& A, const v2& B, const v2& C ) const {return (C.y-A.y)*(B.x-A.x) > (B.y-A.y)*(C.x-A.x);}
+        // determine if three points are listed in a counterclockwise order (exact)
+        bool __ccw__( const v2& A, const v2& B, const v2& C ) const {return predicates::orient2d(A.x, A.y, B.x, B.y, C.x, C.y) > 0;}
 
-        // Determine if two line segments intersects with each other
+        // Determine if two line segments intersects with each other.
+        // Exact; touching and collinear overlapping segments intersect.
         bool intersects( const Line_segment& other ) const
         {
             const v2& A = this->start; const v2& B = this->end;
             const v2& C = other.start; const v2& D = other.end;
-            return __ccw__(A,C,D) != __ccw__(B,C,D) && __ccw__(A,B,C) != __ccw__(A,B,D);
+            return predicates::segments_intersect(A.x, A.y, B.x, B.y, C.x, C.y, D.x, D.y);
         }
 
         //Return the closest point on the line segment to `pt`.
@@ -234,6 +238,44 @@ namespace N2D
 
     std::ostream& operator << (std::ostream& str, const Line_segment& line);
 
+    /*****************************
+     * 2D Axis Aligned Bounding Box
+     *****************************/
+    struct AABB
+    {
+        v2 min, max;
+
+        // An empty box. Expanding it by any point gives the box of that point.
+        explicit AABB() : min(MAX_DOUBLE, MAX_DOUBLE), max(-MAX_DOUBLE, -MAX_DOUBLE) {}
+        explicit AABB(const v2& min_, const v2& max_) : min(min_), max(max_) {}
+
+        bool empty() const { return min.x > max.x || min.y > max.y; }
+
+        // grow the box so it contains the point
+        void expand( const v2& pt )
+        {
+            min.x = std::min(min.x, pt.x); min.y = std::min(min.y, pt.y);
+            max.x = std::max(max.x, pt.x); max.y = std::max(max.y, pt.y);
+        }
+
+        // grow the box so it contains the other box
+        void expand( const AABB& other )
+        {
+            min.x = std::min(min.x, other.min.x); min.y = std::min(min.y, other.min.y);
+            max.x = std::max(max.x, other.max.x); max.y = std::max(max.y, other.max.y);
+        }
+
+        bool contains( const v2& pt ) const { return pt.x >= min.x && pt.x <= max.x && pt.y >= min.y && pt.y <= max.y; }
+
+        // returns true if two boxes overlap (touching counts as overlapping)
+        bool overlaps( const AABB& other ) const
+        {
+            return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+        }
+
+        v2 center() const { return (min + max) * 0.5; }
+    };
+
     /*****************************
      * 2D Sphere
      *****************************/
@@ -0,0 +1,396 @@
+//
+//  kd_tree.h
+//  Naive2D
+//
+//  KD-trees over v2 point sets for k-nearest and radius queries under the
+//  L1, L2 and L-infinity metrics (SPHEREMETRIC).
+//
+//  KD_tree is static. Its points are reordered into tree order once, and the
+//  tree is implicit in that order: a range [begin, end) splits at its middle
+//  point, so the only per-node data is the split axis. Queries walk one
+//  contiguous array.
+//
+//  Incremental_KD_tree supports insertion (e.g. RRT) with the logarithmic
+//  method: a small unsorted buffer plus static trees of sizes B, 2B, 4B, ...
+//  which are merged like a binary counter as points come in.
+//
+
+#ifndef Naive2D_kd_tree_h
+#define Naive2D_kd_tree_h
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "geometry.h"
+
+namespace N2D {
+
+    struct Neighbor
+    {
+        uint32_t index;     // index of the point in the input (insertion order)
+        double distance;
+    };
+
+    namespace kd_detail
+    {
+        // Distances are compared in a "key" space: squared for L2, plain for the others.
+        static inline double key( const v2& d, SPHEREMETRIC metric )
+        {
+            switch (metric) {
+                case SPHEREMETRIC::L1:     return d.l1();
+                case SPHEREMETRIC::LINFTY: return d.linfty();
+                default:                   return d.rsq();
+            }
+        }
+
+        // Lower bound of the key of any point across a splitting plane at distance `diff`.
+        static inline double axis_key( double diff, SPHEREMETRIC metric )
+        {
+            return metric == SPHEREMETRIC::L2 ? diff * diff : std::fabs(diff);
+        }
+
+        static inline double to_key( double distance, SPHEREMETRIC metric )
+        {
+            return metric == SPHEREMETRIC::L2 ? distance * distance : distance;
+        }
+
+        static inline double from_key( double key, SPHEREMETRIC metric )
+        {
+            return metric == SPHEREMETRIC::L2 ? std::sqrt(key) : key;
+        }
+
+        // The k best so far, sorted by key. Fine for the small k planners use.
+        struct Best_k
+        {
+            std::vector<Neighbor>& best;    // distances hold keys while searching
+            unsigned k;
+
+            double worst() const { return best.size() < k ? MAX_DOUBLE : best.back().distance; }
+
+            void offer( uint32_t index, double key )
+            {
+                if( best.size() == k )
+                {
+                    if( key >= best.back().distance ) return;
+                    best.pop_back();
+                }
+                auto it = std::upper_bound(best.begin(), best.end(), key, [](double value, const Neighbor& n){ return value < n.distance; });
+                best.insert(it, Neighbor{index, key});
+            }
+        };
+    }
+
+    class KD_tree
+    {
+    public:
+        static constexpr unsigned LEAF_SIZE = 8;
+
+        KD_tree() = default;
+
+        // Builds the tree over a copy of the points. Neighbors refer to positions in `points`.
+        explicit KD_tree( const std::vector<v2>& points )
+        {
+            std::vector<uint32_t> ids(points.size());
+            for( uint32_t i = 0; i < ids.size(); i++ ) ids[i] = i;
+            build(points, ids);
+        }
+
+        // Builds the tree over points with caller chosen ids.
+        KD_tree( const std::vector<v2>& points, const std::vector<uint32_t>& ids ) { build(points, ids); }
+
+        size_t size() const { return pts.size(); }
+
+        // points and their ids in tree order
+        const std::vector<v2>& tree_points() const { return pts; }
+        const std::vector<uint32_t>& tree_ids() const { return ids; }
+
+        // The k nearest points, closest first.
+        std::vector<Neighbor> k_nearest( const v2& query, unsigned k, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<Neighbor> result;
+            k_nearest(query, k, result, metric);
+            return result;
+        }
+
+        void k_nearest( const v2& query, unsigned k, std::vector<Neighbor>& result, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            result.clear();
+            if( k == 0 ) return;
+            result.reserve(k + 1);
+            kd_detail::Best_k best{result, k};
+            search_k(query, best, metric);
+            for( Neighbor& n : result ) n.distance = kd_detail::from_key(n.distance, metric);
+        }
+
+        // Index of the nearest point, or -1 if the tree is empty.
+        int64_t nearest( const v2& query, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<Neighbor> result;
+            k_nearest(query, 1, result, metric);
+            return result.empty() ? -1 : (int64_t)result[0].index;
+        }
+
+        // All points within distance `radius` (inclusive), in no particular order.
+        void within_radius( const v2& query, double radius, std::vector<Neighbor>& result, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            result.clear();
+            // no point is closer than 0; the L2 key would square a negative radius into a positive one
+            if( radius < 0 ) return;
+            search_radius(query, kd_detail::to_key(radius, metric), result, metric);
+            for( Neighbor& n : result ) n.distance = kd_detail::from_key(n.distance, metric);
+        }
+
+        std::vector<Neighbor> within_radius( const v2& query, double radius, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<Neighbor> result;
+            within_radius(query, radius, result, metric);
+            return result;
+        }
+
+        // Batched k-nearest, queries spread over threads.
+        std::vector<std::vector<Neighbor>> k_nearest( const std::vector<v2>& queries, unsigned k, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<std::vector<Neighbor>> results(queries.size());
+            #pragma omp parallel for schedule(static, 64)
+            for( long i = 0; i < (long)queries.size(); i++ )
+                k_nearest(queries[i], k, results[i], metric);
+            return results;
+        }
+
+        // Batched radius query, queries spread over threads.
+        std::vector<std::vector<Neighbor>> within_radius( const std::vector<v2>& queries, double radius, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<std::vector<Neighbor>> results(queries.size());
+            #pragma omp parallel for schedule(static, 64)
+            for( long i = 0; i < (long)queries.size(); i++ )
+                within_radius(queries[i], radius, results[i], metric);
+            return results;
+        }
+
+        // Search continuing from an existing best list (keys, not distances). Used to search several trees.
+        void search_k( const v2& query, kd_detail::Best_k& best, SPHEREMETRIC metric ) const
+        {
+            if( !pts.empty() ) search_k(0, (uint32_t)pts.size(), query, best, metric);
+        }
+
+        // Appends the points with key <= max_key, distances as keys.
+        void search_radius( const v2& query, double max_key, std::vector<Neighbor>& result, SPHEREMETRIC metric ) const
+        {
+            if( !pts.empty() ) search_radius(0, (uint32_t)pts.size(), query, max_key, result, metric);
+        }
+
+    private:
+        std::vector<v2> pts;            // points in tree order
+        std::vector<uint32_t> ids;      // ids in tree order
+        std::vector<uint8_t> axes;      // split axis of the range whose middle is this position
+
+        static double coord( const v2& p, int axis ) { return axis == 0 ? p.x : p.y; }
+
+        void build( const std::vector<v2>& points, const std::vector<uint32_t>& point_ids )
+        {
+            assert(points.size() == point_ids.size());
+            if( points.size() >= UINT32_MAX )
+                throw "KD_tree: too many points.";
+            pts = points;
+            ids = point_ids;
+            axes.assign(points.size(), 0);
+            build(0, (uint32_t)pts.size());
+        }
+
+        // Partitions pts and ids in place around the median of the wider axis.
+        void build( uint32_t begin, uint32_t end )
+        {
+            if( end - begin <= LEAF_SIZE ) return;
+            AABB box;
+            for( uint32_t i = begin; i < end; i++ ) box.expand(pts[i]);
+            int axis = (box.max.x - box.min.x) >= (box.max.y - box.min.y) ? 0 : 1;
+            uint32_t mid = begin + (end - begin) / 2;
+            select(begin, end, mid, axis);
+            axes[mid] = (uint8_t)axis;
+            build(begin, mid);
+            build(mid + 1, end);
+        }
+
+        void swap_items( uint32_t a, uint32_t b )
+        {
+            std::swap(pts[a], pts[b]);
+            std::swap(ids[a], ids[b]);
+        }
+
+        // Quickselect: afterwards pts[nth] is in its sorted position on `axis`.
+        // Hoare partitioning keeps it balanced when many points share a coordinate.
+        void select( uint32_t begin, uint32_t end, uint32_t nth, int axis )
+        {
+            while( end - begin > 1 )
+            {
+                // median of three as pivot, moved to begin
+                uint32_t mid = begin + (end - begin) / 2;
+                double a = coord(pts[begin], axis), b = coord(pts[mid], axis), c = coord(pts[end - 1], axis);
+                if( (a < b) == (a < c) )
+                    swap_items(begin, (b < a) != (b < c) ? mid : end - 1);
+                double pivot = coord(pts[begin], axis);
+
+                int64_t i = (int64_t)begin - 1, j = end;
+                while( true )
+                {
+                    do i++; while( coord(pts[i], axis) < pivot );
+                    do j--; while( coord(pts[j], axis) > pivot );
+                    if( i >= j ) break;
+                    swap_items((uint32_t)i, (uint32_t)j);
+                }
+                // [begin, j] <= pivot <= [j + 1, end)
+                if( nth <= (uint32_t)j ) end = (uint32_t)j + 1;
+                else begin = (uint32_t)j + 1;
+            }
+        }
+
+        void search_k( uint32_t begin, uint32_t end, const v2& query, kd_detail::Best_k& best, SPHEREMETRIC metric ) const
+        {
+            if( end - begin <= LEAF_SIZE )
+            {
+                for( uint32_t i = begin; i < end; i++ )
+                    best.offer(ids[i], kd_detail::key(pts[i] - query, metric));
+                return;
+            }
+            uint32_t mid = begin + (end - begin) / 2;
+            int axis = axes[mid];
+            double diff = coord(query, axis) - coord(pts[mid], axis);
+            best.offer(ids[mid], kd_detail::key(pts[mid] - query, metric));
+            if( diff < 0 )
+            {
+                search_k(begin, mid, query, best, metric);
+                if( kd_detail::axis_key(diff, metric) < best.worst() ) search_k(mid + 1, end, query, best, metric);
+            }
+            else
+            {
+                search_k(mid + 1, end, query, best, metric);
+                if( kd_detail::axis_key(diff, metric) < best.worst() ) search_k(begin, mid, query, best, metric);
+            }
+        }
+
+        void search_radius( uint32_t begin, uint32_t end, const v2& query, double max_key, std::vector<Neighbor>& result, SPHEREMETRIC metric ) const
+        {
+            if( end - begin <= LEAF_SIZE )
+            {
+                for( uint32_t i = begin; i < end; i++ )
+                {
+                    double k = kd_detail::key(pts[i] - query, metric);
+                    if( k <= max_key ) result.push_back(Neighbor{ids[i], k});
+                }
+                return;
+            }
+            uint32_t mid = begin + (end - begin) / 2;
+            int axis = axes[mid];
+            double diff = coord(query, axis) - coord(pts[mid], axis);
+            double k = kd_detail::key(pts[mid] - query, metric);
+            if( k <= max_key ) result.push_back(Neighbor{ids[mid], k});
+            bool near_far = kd_detail::axis_key(diff, metric) <= max_key;
+            if( diff < 0 || near_far ) search_radius(begin, mid, query, max_key, result, metric);
+            if( diff >= 0 || near_far ) search_radius(mid + 1, end, query, max_key, result, metric);
+        }
+    };
+
+    /* A KD-tree that grows one point at a time. Insertion is amortized O(log^2 n);
+     * queries search O(log n) static trees.
+     */
+    class Incremental_KD_tree
+    {
+    public:
+        static constexpr unsigned BUFFER_SIZE = 64;
+
+        // Adds a point and returns its index (insertion order).
+        uint32_t insert( const v2& point )
+        {
+            uint32_t id = (uint32_t)points.size();
+            points.push_back(point);
+            buffer.push_back(id);
+            if( buffer.size() == BUFFER_SIZE )
+                flush_buffer();
+            return id;
+        }
+
+        size_t size() const { return points.size(); }
+
+        const v2& point( uint32_t index ) const { return points[index]; }
+
+        std::vector<Neighbor> k_nearest( const v2& query, unsigned k, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<Neighbor> result;
+            k_nearest(query, k, result, metric);
+            return result;
+        }
+
+        void k_nearest( const v2& query, unsigned k, std::vector<Neighbor>& result, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            result.clear();
+            if( k == 0 ) return;
+            result.reserve(k + 1);
+            kd_detail::Best_k best{result, k};
+            for( uint32_t id : buffer )
+                best.offer(id, kd_detail::key(points[id] - query, metric));
+            for( const std::unique_ptr<KD_tree>& tree : trees )
+                if( tree ) tree->search_k(query, best, metric);
+            for( Neighbor& n : result ) n.distance = kd_detail::from_key(n.distance, metric);
+        }
+
+        int64_t nearest( const v2& query, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<Neighbor> result;
+            k_nearest(query, 1, result, metric);
+            return result.empty() ? -1 : (int64_t)result[0].index;
+        }
+
+        void within_radius( const v2& query, double radius, std::vector<Neighbor>& result, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            result.clear();
+            if( radius < 0 ) return;
+            double max_key = kd_detail::to_key(radius, metric);
+            for( uint32_t id : buffer )
+            {
+                double k = kd_detail::key(points[id] - query, metric);
+                if( k <= max_key ) result.push_back(Neighbor{id, k});
+            }
+            for( const std::unique_ptr<KD_tree>& tree : trees )
+                if( tree ) tree->search_radius(query, max_key, result, metric);
+            for( Neighbor& n : result ) n.distance = kd_detail::from_key(n.distance, metric);
+        }
+
+        std::vector<Neighbor> within_radius( const v2& query, double radius, SPHEREMETRIC metric = SPHEREMETRIC::L2 ) const
+        {
+            std::vector<Neighbor> result;
+            within_radius(query, radius, result, metric);
+            return result;
+        }
+
+    private:
+        std::vector<v2> points;                         // every point, by index
+        std::vector<uint32_t> buffer;                   // recent points not in any tree yet
+        std::vector<std::unique_ptr<KD_tree>> trees;    // trees[i] holds BUFFER_SIZE * 2^i points or nothing
+
+        // Like incrementing a binary counter: merge full levels until an empty one is found.
+        void flush_buffer()
+        {
+            std::vector<uint32_t> carry;
+            carry.swap(buffer);
+            size_t level = 0;
+            for( ; level < trees.size() && trees[level]; level++ )
+            {
+                const std::vector<uint32_t>& ids = trees[level]->tree_ids();
+                carry.insert(carry.end(), ids.begin(), ids.end());
+                trees[level].reset();
+            }
+            if( level == trees.size() )
+                trees.emplace_back();
+            std::vector<v2> carry_points(carry.size());
+            for( size_t i = 0; i < carry.size(); i++ )
+                carry_points[i] = points[carry[i]];
+            trees[level].reset(new KD_tree(carry_points, carry));
+        }
+    };
+}
+
+#endif
@@ -8,9 +8,30 @@
 
 #include <iostream>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "geometry.h"
 #include "polygon.h"
 #include "render.h"
+#include "scene_file.h"
+#include "polygon_store.h"
+#include "sweep_prune.h"
+#include "collision_cache.h"
+#include "simplify.h"
+#include "path_validation.h"
+#include "kd_tree.h"
+#include "fixed_polygon.h"
+#include "contact.h"
+#include "visibility_graph.h"
+#include "trace.h"
+#include "scene_generator.h"
+#include "differential.h"
+#include "edge_bvh.h"
+#include "raycast.h"
+#include "occupancy.h"
+#include "GJK_batch.h"
+#include "concurrent_scene.h"
 
 using namespace N2D;
 using namespace std::chrono;
@@ -49,6 +70,812 @@ void performance_test(){
     cout << duration / double(N) << " ms per test." << endl;
 }
 
+// Writes a scene of N triangles, then times how long it takes to open it and touch every polygon.
+void scene_file_test(){
+    const char* path = "scene_file_test.n2ds";
+    int N = 1000000;
+    {
+        Scene_writer writer(path);
+        for(int i = 0; i < N; i++){
+            double x = (i % 1000) * 10.0, y = (i / 1000) * 10.0;
+            v2 points[] = {v2(x, y), v2(x+5, y), v2(x, y+5)};
+            writer.add_polygon(points, 3);
+        }
+        writer.finish();
+    }
+
+    auto start = high_resolution_clock::now();
+    Scene_file scene(path);
+    auto opened = high_resolution_clock::now();
+    double area = 0.0;
+    for(uint64_t i = 0; i < scene.polygon_count(); i++){
+        AABB box = scene.bounds(i);
+        area += (box.max.x - box.min.x) * (box.max.y - box.min.y);
+    }
+    auto end = high_resolution_clock::now();
+    cout << scene.polygon_count() << " polygons in the scene file\n";
+    cout << duration_cast<microseconds>(opened - start).count() / 1000.0 << " ms to open\n";
+    cout << duration_cast<microseconds>(end - opened).count() / 1000.0 << " ms to sweep all bounds (total area " << area << ")" << endl;
+    std::remove(path);
+}
+
+// Sweeps a whole scene once stored as separate Polygons and once in a Polygon_store.
+void polygon_store_test(){
+    int N = 200000;
+    std::vector<Polygon> polygons;
+    for(int i = 0; i < N; i++){
+        double x = (i % 500) * 10.0, y = (i / 500) * 10.0;
+        v2 points[] = {v2(x, y), v2(x+5, y), v2(x+5, y+5), v2(x, y+5)};
+        polygons.emplace_back(points, 4);
+    }
+    Polygon_store store;
+    store.add(polygons);
+
+    v2 robot_points[] = {v2(2500, 2000), v2(2510, 2000), v2(2510, 2010), v2(2500, 2010)};
+    Polygon robot(robot_points, 4);
+
+    auto start = high_resolution_clock::now();
+    int hits = 0;
+    for(const Polygon& polygon : polygons)
+        hits += robot.intersects(polygon);
+    auto middle = high_resolution_clock::now();
+    int store_hits = 0;
+    for(Polygon_store::id_type id = 0; id < store.size(); id++)
+        store_hits += robot.view().intersects(store[id]);
+    auto end = high_resolution_clock::now();
+    cout << N << " polygons, " << hits << " / " << store_hits << " collisions\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms with std::vector<Polygon>\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms with Polygon_store" << endl;
+}
+
+// N slowly moving rectangles: all-pairs GJK every tick vs sweep and prune + GJK on its pairs.
+void sweep_prune_test(){
+    int N = 2000, ticks = 100;
+    std::vector<Polygon> polygons;
+    std::vector<v2> velocity;
+    for(int i = 0; i < N; i++){
+        double x = (i % 50) * 12.0, y = (i / 50) * 12.0;
+        v2 points[] = {v2(x, y), v2(x+10, y), v2(x+10, y+10), v2(x, y+10)};
+        polygons.emplace_back(points, 4);
+        velocity.push_back(v2(((i * 7919) % 21 - 10) * 0.01, ((i * 104729) % 21 - 10) * 0.01));
+    }
+    std::vector<Polygon> moving = polygons;
+
+    auto start = high_resolution_clock::now();
+    long brute_hits = 0;
+    for(int t = 0; t < ticks; t++){
+        for(int i = 0; i < N; i++) polygons[i].self_translate(velocity[i]);
+        for(int i = 0; i < N; i++)
+            for(int j = i + 1; j < N; j++)
+                brute_hits += polygons[i].intersects(polygons[j]);
+    }
+    auto middle = high_resolution_clock::now();
+    Sweep_and_prune sap;
+    for(int i = 0; i < N; i++) sap.add(moving[i]);
+    long sap_hits = 0;
+    for(int t = 0; t < ticks; t++){
+        for(int i = 0; i < N; i++){
+            moving[i].self_translate(velocity[i]);
+            sap.update(i, moving[i]);
+        }
+        sap.clear_events();
+        sap.for_each_pair([&](Sweep_and_prune::id_type a, Sweep_and_prune::id_type b){
+            sap_hits += moving[a].intersects(moving[b]);
+        });
+    }
+    auto end = high_resolution_clock::now();
+    cout << N << " moving polygons, " << ticks << " ticks, " << brute_hits << " / " << sap_hits << " collisions\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms all pairs\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms sweep and prune" << endl;
+}
+
+// Planner-like sampling where configurations repeat: direct queries vs Collision_cache.
+void collision_cache_test(){
+    std::vector<Polygon> obstacles;
+    for(int i = 0; i < 400; i++){
+        double x = (i % 20) * 50.0, y = (i / 20) * 50.0;
+        v2 points[] = {v2(x, y), v2(x+20, y), v2(x+20, y+20), v2(x, y+20)};
+        obstacles.emplace_back(points, 4);
+    }
+    v2 robot_points[] = {v2(-5, -3), v2(5, -3), v2(5, 3), v2(-5, 3)};
+    Polygon robot(robot_points, 4);
+    Collision_cache cache(robot, obstacles, 0.5, 0.05, 100000);
+
+    int N = 200000;
+    std::vector<v2> samples;
+    for(int i = 0; i < N; i++){
+        int k = (i * 7919) % 20000;     // configurations repeat, as around an RRT frontier
+        samples.push_back(v2((k % 200) * 5.0, (k / 200) * 10.0));
+    }
+    auto start = high_resolution_clock::now();
+    int direct_hits = 0;
+    std::vector<v2> placed(4);
+    for(int i = 0; i < N; i++){
+        for(int j = 0; j < 4; j++) placed[j] = robot_points[j] + samples[i];
+        Polygon_view view(placed.data(), 4);
+        for(const Polygon& obstacle : obstacles)
+            if(view.intersects(obstacle.view())){ direct_hits++; break; }
+    }
+    auto middle = high_resolution_clock::now();
+    int cached_hits = 0;
+    for(int i = 0; i < N; i++)
+        cached_hits += cache.intersects(samples[i].x, samples[i].y, 0.0);
+    auto end = high_resolution_clock::now();
+    Collision_cache::Stats stats = cache.stats();
+    cout << N << " samples, " << direct_hits << " / " << cached_hits << " in collision, hit rate " << stats.hit_rate() << "\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms direct\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms cached" << endl;
+}
+
+// A dense, noisy, sensor-like outline: vertex reduction of each level and LOD query speed vs the full shape.
+void simplify_test(){
+    int n = 4000;
+    std::vector<v2> outline;
+    for(int i = 0; i < n; i++){
+        double angle = -2 * PI * i / n;     // clockwise
+        double r = 200 + 20 * sin(3 * angle) + ((i * 7919) % 101) * 0.02;
+        outline.push_back(v2(500 + r * cos(angle), 500 + r * sin(angle)));
+    }
+    Polygon obstacle(std::move(outline));
+    LOD_polygon lod(obstacle, {10, 2});
+    cout << "full outline: " << obstacle.vertices.size() << " vertices\n";
+    for(size_t i = 0; i < lod.levels.size(); i++)
+        cout << "level " << i << ": " << lod.vertex_count(i) << " vertices\n";
+
+    std::vector<Polygon> robots;
+    for(int i = 0; i < 2000; i++){
+        double x = (i % 50) * 20.0, y = (i / 50) * 25.0;
+        v2 points[] = {v2(x, y), v2(x+8, y), v2(x+8, y+8), v2(x, y+8)};
+        robots.emplace_back(points, 4);
+    }
+    auto start = high_resolution_clock::now();
+    int full_hits = 0;
+    for(const Polygon& robot : robots) full_hits += obstacle.naive_intersects(robot);
+    auto middle = high_resolution_clock::now();
+    int lod_hits = 0;
+    for(const Polygon& robot : robots) lod_hits += lod.intersects(robot);
+    auto end = high_resolution_clock::now();
+    cout << robots.size() << " queries, " << full_hits << " / " << lod_hits << " collisions\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms on the full outline\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms with levels of detail" << endl;
+}
+
+// A long free path through an obstacle field: stepping with self_translate + intersects vs swept hulls.
+void path_validation_test(){
+    std::vector<Polygon> obstacles;
+    for(int i = 0; i < 500; i++){
+        double x = (i % 25) * 40.0, y = (i / 25) * 40.0 + 20.0;
+        v2 points[] = {v2(x, y), v2(x+15, y), v2(x+15, y+15), v2(x, y+15)};
+        obstacles.emplace_back(points, 4);
+    }
+    v2 robot_points[] = {v2(-2, -2), v2(2, -2), v2(2, 2), v2(-2, 2)};
+    Polygon robot(robot_points, 4);
+    std::vector<v2> path;
+    for(int i = 0; i < 40; i++)
+        path.push_back(v2((i % 2) ? 990.0 : 0.0, 5.0));   // back and forth in a free corridor
+
+    double step = 0.5;
+    auto start = high_resolution_clock::now();
+    int sampled_hit = -1;
+    for(size_t k = 0; k + 1 < path.size() && sampled_hit < 0; k++){
+        Polygon moving(robot);
+        moving.self_translate(path[k]);
+        v2 delta = path[k+1] - path[k];
+        int steps = (int)(delta.r() / step) + 1;
+        for(int s = 0; s <= steps && sampled_hit < 0; s++){
+            for(const Polygon& obstacle : obstacles)
+                if(moving.intersects(obstacle)){ sampled_hit = (int)k; break; }
+            moving.self_translate(delta / steps);
+        }
+    }
+    auto middle = high_resolution_clock::now();
+    Path_validator validator(obstacles);
+    int swept_hit = validator.first_collision(robot, path);
+    auto end = high_resolution_clock::now();
+    cout << path.size() - 1 << " segments, first collision " << sampled_hit << " / " << swept_hit << "\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms stepping every " << step << "\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms with swept hulls" << endl;
+}
+
+// k-nearest queries with a KD_tree vs brute force, from 10k to 10M points.
+void kd_tree_test(){
+    for(int n : {10000, 100000, 1000000, 10000000}){
+        std::vector<v2> points(n);
+        unsigned seed = 12345;
+        for(v2& p : points){
+            seed = seed * 1103515245 + 12345; p.x = (seed >> 8) % 100000 / 10.0;
+            seed = seed * 1103515245 + 12345; p.y = (seed >> 8) % 100000 / 10.0;
+        }
+        std::vector<v2> queries;
+        for(int i = 0; i < 100000; i++) queries.push_back(points[(i * 7919) % n] + v2(0.5, 0.5));
+
+        auto start = high_resolution_clock::now();
+        KD_tree tree(points);
+        auto built = high_resolution_clock::now();
+        std::vector<std::vector<Neighbor>> result = tree.k_nearest(queries, 10);
+        auto queried = high_resolution_clock::now();
+        int brute_queries = 100;
+        double checksum = 0.0;
+        for(int i = 0; i < brute_queries; i++){
+            double best = MAX_DOUBLE;
+            for(const v2& p : points) best = std::min(best, (p - queries[i]).rsq());
+            checksum += std::fabs(std::sqrt(best) - result[i][0].distance);
+        }
+        auto end = high_resolution_clock::now();
+        cout << n << " points: build " << duration_cast<microseconds>(built - start).count() / 1000.0 << " ms, "
+             << duration_cast<nanoseconds>(queried - built).count() / double(queries.size()) << " ns per 10-NN query, "
+             << duration_cast<nanoseconds>(end - queried).count() / double(brute_queries) << " ns per brute force 1-NN"
+             << " (error " << checksum << ")" << endl;
+    }
+}
+
+// Filtered exact segment tests vs the plain double ccw test they replaced.
+void predicates_test(){
+    int N = 1000000;
+    std::vector<Line_segment> segments;
+    unsigned seed = 777;
+    auto next = [&seed](){ seed = seed * 1103515245 + 12345; return (seed >> 8) % 10000 / 10.0; };
+    for(int i = 0; i < N; i++){
+        v2 start(next(), next());
+        segments.push_back(Line_segment(start, start + v2(next() / 10.0, next() / 10.0)));
+    }
+    auto ccw = [](const v2& A, const v2& B, const v2& C){ return (C.y-A.y)*(B.x-A.x) > (B.y-A.y)*(C.x-A.x); };
+
+    auto start = high_resolution_clock::now();
+    int plain_hits = 0;
+    for(int i = 0; i + 1 < N; i++){
+        const v2& A = segments[i].start; const v2& B = segments[i].end;
+        const v2& C = segments[i+1].start; const v2& D = segments[i+1].end;
+        plain_hits += ccw(A,C,D) != ccw(B,C,D) && ccw(A,B,C) != ccw(A,B,D);
+    }
+    auto middle = high_resolution_clock::now();
+    int exact_hits = 0;
+    for(int i = 0; i + 1 < N; i++)
+        exact_hits += segments[i].intersects(segments[i+1]);
+    auto end = high_resolution_clock::now();
+    cout << N << " segment pairs, " << plain_hits << " / " << exact_hits << " intersecting\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms plain ccw\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms filtered exact" << endl;
+
+    // point containment: the old ray crossing test with plain ccw vs Polygon::contains
+    std::vector<v2> outline;
+    for(int i = 0; i < 64; i++){
+        double angle = -2 * PI * i / 64;
+        outline.push_back(v2(500 + 300 * cos(angle), 500 + 300 * sin(angle)));
+    }
+    Polygon polygon(std::move(outline));
+    unsigned size = (unsigned)polygon.vertices.size();
+    start = high_resolution_clock::now();
+    int plain_inside = 0;
+    for(int i = 0; i < N; i++){
+        const v2& point = segments[i].start;
+        const v2 outside(300000, 300000);
+        int crossings = 0;
+        for(unsigned j = 0; j < size; j++){
+            const v2& A = polygon.vertices[j]; const v2& B = polygon.vertices[(j + 1) % size];
+            crossings += ccw(A,point,outside) != ccw(B,point,outside) && ccw(A,B,point) != ccw(A,B,outside);
+        }
+        plain_inside += crossings & 1;
+    }
+    middle = high_resolution_clock::now();
+    int exact_inside = 0;
+    for(int i = 0; i < N; i++)
+        exact_inside += polygon.contains(segments[i].start);
+    end = high_resolution_clock::now();
+    cout << N << " points, " << plain_inside << " / " << exact_inside << " inside a 64-gon\n";
+    cout << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms plain ccw ray crossing\n";
+    cout << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms filtered exact contains" << endl;
+}
+
+// The rectangle benchmark of performance_test with Polygon, Fixed_polygon (GJK) and SAT.
+// rect2 slides a little every iteration so the compiler cannot hoist the test out of the loop.
+void fixed_polygon_test(){
+    v2 points1[] = {v2(0, 0), v2(10, 0), v2(10, 10), v2(0, 10)};
+    v2 points2[] = {v2(5, 5), v2(15, 5), v2(15, 15), v2(5, 15)};
+    Polygon rect1( points1, 4 );
+    Polygon rect2( points2, 4 );
+    Quad fixed1(points1[0], points1[1], points1[2], points1[3]);
+    Quad fixed2(points2[0], points2[1], points2[2], points2[3]);
+    v2 step(1e-6, 0);
+
+    int N = 10000000;
+    auto start = high_resolution_clock::now();
+    int hits = 0;
+    for(int i = 0; i < N; i++){
+        rect2.self_translate(step);
+        hits += rect1.intersects(rect2);
+    }
+    auto middle = high_resolution_clock::now();
+    int fixed_hits = 0;
+    for(int i = 0; i < N; i++){
+        fixed2.self_translate(step);
+        fixed_hits += fixed1.intersects(fixed2);
+    }
+    auto middle2 = high_resolution_clock::now();
+    fixed2 = Quad(points2[0], points2[1], points2[2], points2[3]);
+    int sat_hits = 0;
+    for(int i = 0; i < N; i++){
+        fixed2.self_translate(step);
+        sat_hits += SAT::intersects(fixed1, fixed2);
+    }
+    auto end = high_resolution_clock::now();
+    cout << N << " rectangle tests, " << hits << " / " << fixed_hits << " / " << sat_hits << " collisions\n";
+    cout << duration_cast<nanoseconds>(middle - start).count() / double(N) << " ns per Polygon GJK test\n";
+    cout << duration_cast<nanoseconds>(middle2 - middle).count() / double(N) << " ns per Fixed_polygon GJK test\n";
+    cout << duration_cast<nanoseconds>(end - middle2).count() / double(N) << " ns per Fixed_polygon SAT test" << endl;
+}
+
+void contact_test(){
+    std::vector<Polygon> obstacles;
+    for(int i = 0; i < 1000000; i++){
+        double x = (i % 1000) * 3.0, y = (i / 1000) * 3.0;
+        v2 points[] = {v2(x, y), v2(x+2, y+0.5), v2(x+1.5, y+2), v2(x-0.5, y+1.5)};
+        obstacles.emplace_back(points, 4);
+    }
+    v2 robot_points[] = {v2(-1, -1), v2(1, -1), v2(1, 1), v2(-1, 1)};
+    Polygon robot(robot_points, 4);
+    robot.self_translate(v2(1.7, 1.2));
+    std::vector<Contact_manifold> manifolds(obstacles.size());
+
+    auto start = high_resolution_clock::now();
+    for(size_t i = 0; i < obstacles.size(); i++)
+        manifolds[i] = contact(robot, obstacles[i], 2.0);
+    auto middle = high_resolution_clock::now();
+    contacts(robot.view(), obstacles, 2.0, manifolds.data());
+    auto end = high_resolution_clock::now();
+    int touching = 0, points = 0;
+    for(const Contact_manifold& manifold : manifolds){
+        touching += manifold.touching();
+        points += manifold.count;
+    }
+    cout << obstacles.size() << " manifolds, " << touching << " touching, " << points << " contact points\n";
+    cout << duration_cast<nanoseconds>(middle - start).count() / double(obstacles.size()) << " ns per manifold\n";
+    cout << duration_cast<nanoseconds>(end - middle).count() / double(obstacles.size()) << " ns per manifold in parallel" << endl;
+}
+
+// convex obstacles with 6 vertices on a jittered grid, so that they do not overlap
+std::vector<Polygon> grid_obstacles( int count, unsigned seed ){
+    srand(seed);
+    int side = (int)std::ceil(std::sqrt((double)count));
+    std::vector<Polygon> obstacles;
+    for(int i = 0; i < count; i++){
+        v2 center((i % side) * 10.0 + 5.0, (i / side) * 10.0 + 5.0);
+        center += v2(rand() % 100 / 50.0 - 1.0, rand() % 100 / 50.0 - 1.0);
+        double radius = 1.0 + rand() % 100 / 40.0, phase = rand() % 100 / 100.0;
+        std::vector<v2> points;
+        for(int k = 0; k < 6; k++){
+            double angle = -(k + phase) * PI / 3;     // clockwise
+            points.push_back(center + v2(radius * cos(angle), radius * sin(angle)));
+        }
+        obstacles.emplace_back(std::move(points));
+    }
+    return obstacles;
+}
+
+void visibility_graph_test(){
+    for(int vertices : {1000, 5000, 20000}){
+        std::vector<Polygon> obstacles = grid_obstacles(vertices / 6, 7);
+        auto start = high_resolution_clock::now();
+        Visibility_graph graph(obstacles);
+        auto end = high_resolution_clock::now();
+        cout << graph.size() << " vertices, " << graph.edge_count() << " edges, "
+             << duration_cast<milliseconds>(end - start).count() << " ms with the rotational sweep\n";
+
+        if(vertices > 1000) continue;
+        // every pair against every obstacle
+        std::vector<v2> points;
+        std::vector<int> owner;
+        for(size_t k = 0; k < obstacles.size(); k++)
+            for(const v2& point : obstacles[k].vertices){ points.push_back(point); owner.push_back((int)k); }
+        start = high_resolution_clock::now();
+        long edges = 0;
+        for(size_t i = 0; i < points.size(); i++){
+            for(size_t j = i + 1; j < points.size(); j++){
+                bool visible = true;
+                if(owner[i] == owner[j])    // convex: only the sides of the obstacle
+                    visible = (j - i == 1) || (j - i == 5);
+                Line_segment line(points[i], points[j]);
+                for(size_t k = 0; k < obstacles.size() && visible; k++){
+                    if((int)k != owner[i] && (int)k != owner[j])
+                        visible = !obstacles[k].intersects(line);
+                    else if(owner[i] != owner[j])   // must not cut through its own obstacle
+                        visible = !obstacles[k].contains((int)k == owner[i] ? points[i] + (points[j] - points[i]) * 1e-6
+                                                                            : points[j] + (points[i] - points[j]) * 1e-6);
+                }
+                edges += visible;
+            }
+        }
+        end = high_resolution_clock::now();
+        cout << points.size() << " vertices, " << edges << " edges, "
+             << duration_cast<milliseconds>(end - start).count() << " ms testing every pair" << endl;
+    }
+}
+
+// build with -DN2D_ENABLE_TRACE and open trace.json in chrome://tracing or https://ui.perfetto.dev
+void trace_test(){
+    std::vector<Polygon> obstacles = grid_obstacles(1000, 1);
+    v2 robot_points[] = {v2(-1, -1), v2(-1, 1), v2(1, 1), v2(1, -1)};
+    Polygon robot(robot_points, 4);
+    std::vector<double> distances(obstacles.size());
+
+    auto start = high_resolution_clock::now();
+    for(int round = 0; round < 10; round++){
+        N2D_TRACE_SPAN("trace_test::round");
+        robot.self_translate(v2(30, 30));
+        int n = (int)obstacles.size();
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; i++)
+            distances[i] = robot.distance_to(obstacles[i]);
+    }
+    auto end = high_resolution_clock::now();
+    cout << 10 * obstacles.size() << " distance queries in " << duration_cast<microseconds>(end - start).count() / 1000.0 << " ms\n";
+#ifdef N2D_ENABLE_TRACE
+    cout << trace::size() << " spans recorded" << endl;
+    trace::save("trace.json");
+#else
+    cout << "tracing is compiled out" << endl;
+#endif
+}
+
+void differential_test(){
+    Differential_harness harness(2026);
+    auto start = high_resolution_clock::now();
+    size_t disagreements = differential_suite(harness, 1000000);
+    auto end = high_resolution_clock::now();
+    for(const Differential_report& report : harness.results())
+        cout << report << "\n";
+    cout << disagreements << " disagreements in " << duration_cast<milliseconds>(end - start).count() << " ms" << endl;
+
+    Scene_parameters parameters;
+    parameters.convex_fraction = 0.5;
+    Scene_generator generator(2026);
+    start = high_resolution_clock::now();
+    std::vector<Polygon> scene = generator.random_scene(parameters);
+    end = high_resolution_clock::now();
+    cout << scene.size() << " random obstacles in " << duration_cast<microseconds>(end - start).count() / 1000.0 << " ms" << endl;
+}
+
+void edge_bvh_test(){
+    Scene_generator generator(2026);
+    Polygon a = generator.random_star(v2(0, 0), 100, 5000, 0.3);
+    for(double gap : {50.0, 5.0, 0.5, -20.0}){
+        Polygon b = generator.random_star(v2(200 + gap, 0), 100, 5000, 0.3);
+
+        auto start = high_resolution_clock::now();
+        double naive = a.naive_distance_to(b);
+        bool naive_hit = a.naive_intersects(b);
+        auto middle = high_resolution_clock::now();
+        Edge_bvh tree_a(a.view()), tree_b(b.view());
+        auto built = high_resolution_clock::now();
+        double fast = tree_a.distance_to(tree_b);
+        bool fast_hit = tree_a.intersects(tree_b);
+        auto end = high_resolution_clock::now();
+
+        cout << "5000 x 5000 edges, distance " << naive << " / " << fast << ", intersects " << naive_hit << " / " << fast_hit << "\n";
+        cout << "    naive " << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms, edge BVH "
+             << duration_cast<microseconds>(end - built).count() / 1000.0 << " ms + "
+             << duration_cast<microseconds>(built - middle).count() / 1000.0 << " ms to build" << endl;
+    }
+
+    Edge_bvh tree(a.view());
+    std::vector<Line_segment> lines;
+    for(int i = 0; i < 10000; i++)
+        lines.push_back(generator.random_segment(AABB(v2(-150, -150), v2(150, 150)), 50));
+    double naive_sum = 0, fast_sum = 0;
+    int naive_hits = 0, fast_hits = 0;
+    auto start = high_resolution_clock::now();
+    for(const Line_segment& line : lines){
+        naive_sum += a.distance_to(line);
+        naive_hits += a.intersects(line);
+    }
+    auto middle = high_resolution_clock::now();
+    for(const Line_segment& line : lines){
+        fast_sum += tree.distance_to(line);
+        fast_hits += tree.intersects(line);
+    }
+    auto end = high_resolution_clock::now();
+    cout << lines.size() << " segments against 5000 edges, " << naive_hits << " / " << fast_hits << " hits, distance sum " << naive_sum << " / " << fast_sum << "\n";
+    cout << "    naive " << duration_cast<microseconds>(middle - start).count() / double(lines.size()) << " us, edge BVH "
+         << duration_cast<microseconds>(end - middle).count() / double(lines.size()) << " us per segment" << endl;
+}
+
+void lidar_test(){
+    // 1080 beams over 270 degrees with a 100 unit range, on a 10000 x 10000 map
+    const int beams = 1080;
+    const double range = 100.0, fov = 1.5 * PI;
+    Scene_parameters parameters;
+    parameters.region = AABB(v2(0, 0), v2(10000, 10000));
+    parameters.density = 0.05;
+    parameters.min_radius = 2.0;
+    parameters.max_radius = 10.0;
+    parameters.max_vertices = 10;
+    Scene_generator generator(2026);
+    std::vector<Polygon> obstacles = generator.random_scene(parameters);
+
+    auto start = high_resolution_clock::now();
+    Ray_caster caster(obstacles);
+    auto built = high_resolution_clock::now();
+    cout << obstacles.size() << " obstacles, built in " << duration_cast<microseconds>(built - start).count() / 1000.0 << " ms" << endl;
+
+    // poses in free space; a zero length ray hits exactly the obstacles containing its origin
+    std::vector<Ray> rays;
+    for(int sweep = 0; sweep < 100; sweep++){
+        v2 pose = generator.random_point(parameters.region);
+        while( caster.ray_cast(pose, v2(0, 0)).hit ) pose = generator.random_point(parameters.region);
+        double heading = generator.uniform(0.0, 2 * PI);
+        for(int i = 0; i < beams; i++){
+            double angle = heading - fov / 2 + fov * i / (beams - 1);
+            rays.push_back(Ray{pose, v2(range * cos(angle), range * sin(angle))});
+        }
+    }
+
+    // the old way: the intersection point with every edge of every obstacle
+    start = high_resolution_clock::now();
+    std::vector<double> naive(beams, 1.0);
+    for(int i = 0; i < beams; i++){
+        Line_segment beam(rays[i].origin, rays[i].origin + rays[i].translation);
+        for(const Polygon& obstacle : obstacles)
+            for(unsigned j = 0; j < obstacle.vertices.size(); j++){
+                v2 point = beam.intersection_point(Line_segment(obstacle.vertices[j], obstacle.vertices[(j + 1) % obstacle.vertices.size()]));
+                if( point.x != MAX_DOUBLE ) naive[i] = std::min(naive[i], (point - beam.start).r() / range);
+            }
+    }
+    auto middle = high_resolution_clock::now();
+    std::vector<Ray_hit> hits(rays.size());
+    caster.ray_cast(rays.data(), beams, hits.data());
+    auto end = high_resolution_clock::now();
+    int mismatches = 0;
+    for(int i = 0; i < beams; i++)
+        mismatches += std::fabs(naive[i] - (hits[i].hit ? hits[i].fraction : 1.0)) > 1e-9;
+    cout << "one sweep: every edge " << duration_cast<microseconds>(middle - start).count() / 1000.0 << " ms, ray caster "
+         << duration_cast<microseconds>(end - middle).count() / 1000.0 << " ms, " << mismatches << " mismatches" << endl;
+
+    start = high_resolution_clock::now();
+    caster.ray_cast(rays, hits);
+    end = high_resolution_clock::now();
+    int count = 0;
+    for(const Ray_hit& hit : hits) count += hit.hit;
+    double total = duration_cast<microseconds>(end - start).count() / 1000.0;
+    cout << "100 sweeps, " << count << " of " << hits.size() << " beams hit: " << total << " ms, "
+         << total / 100 << " ms per sweep, " << 1000.0 * total / hits.size() << " us per beam" << endl;
+
+    Polygon robot = generator.random_convex(rays[0].origin, 1.0, 6);
+    start = high_resolution_clock::now();
+    count = 0;
+    for(int i = 0; i < beams; i++)
+        count += caster.shape_cast(robot.view(), rays[i].translation).hit;
+    end = high_resolution_clock::now();
+    cout << "robot swept along one sweep of beams, " << count << " hits: "
+         << duration_cast<microseconds>(end - start).count() / double(beams) << " us per cast" << endl;
+}
+
+void occupancy_test(){
+    // an open warehouse: 200 x 100 m with rows of racks, pillars and walls
+    std::vector<Polygon> racks;
+    for(double y = 10; y < 90; y += 4)
+        for(double x = 10; x < 190; x += 24){
+            std::vector<v2> rack = {v2(x, y), v2(x, y + 1.2), v2(x + 20, y + 1.2), v2(x + 20, y)};
+            racks.push_back(Polygon(std::move(rack)));
+        }
+    for(const AABB& wall : {AABB(v2(0, 0), v2(200, 0.3)), AABB(v2(0, 99.7), v2(200, 100)), AABB(v2(0, 0), v2(0.3, 100)), AABB(v2(199.7, 0), v2(200, 100))}){
+        std::vector<v2> corners = {wall.min, v2(wall.min.x, wall.max.y), wall.max, v2(wall.max.x, wall.min.y)};
+        racks.push_back(Polygon(std::move(corners)));
+    }
+    std::vector<sphere> pillars;
+    for(double x = 5; x < 200; x += 12)
+        for(double y = 5; y < 100; y += 30)
+            pillars.push_back(sphere(v2(x, y), 0.4));
+
+    auto start = high_resolution_clock::now();
+    Occupancy_filter filter(racks, pillars, 0.1);
+    auto built = high_resolution_clock::now();
+    cout << racks.size() << " racks and walls, " << pillars.size() << " pillars, bitmap "
+         << filter.bitmap().width(0) << " x " << filter.bitmap().height(0) << " cells, built in "
+         << duration_cast<microseconds>(built - start).count() / 1000.0 << " ms" << endl;
+
+    // a 1 x 0.7 m robot at random poses
+    Scene_generator generator(2026);
+    std::vector<Polygon> footprints;
+    for(int i = 0; i < 1000000; i++){
+        v2 c = generator.random_point(AABB(v2(0, 0), v2(200, 100)));
+        double a = generator.uniform(0.0, 2 * PI);
+        v2 u(0.5 * cos(a), 0.5 * sin(a)), w(-0.35 * sin(a), 0.35 * cos(a));
+        std::vector<v2> corners = {c - u - w, c - u + w, c + u + w, c + u - w};
+        footprints.push_back(Polygon(std::move(corners)));
+    }
+
+    int counts[3] = {0, 0, 0}, hits = 0;
+    start = high_resolution_clock::now();
+    for(const Polygon& footprint : footprints)
+        counts[(int)filter.classify(footprint.view())]++;
+    auto middle = high_resolution_clock::now();
+    for(const Polygon& footprint : footprints)
+        hits += filter.intersects(footprint.view());
+    auto end = high_resolution_clock::now();
+    cout << footprints.size() << " poses: " << counts[0] << " free, " << counts[1] << " occupied, " << counts[2] << " need an exact check" << endl;
+    cout << "    classify " << duration_cast<nanoseconds>(middle - start).count() / double(footprints.size()) << " ns, with exact fallback "
+         << duration_cast<nanoseconds>(end - middle).count() / double(footprints.size()) << " ns per pose, " << hits << " collisions" << endl;
+
+    // every obstacle with a bounding box test first
+    const int checked = 100000;
+    int naive_hits = 0;
+    start = high_resolution_clock::now();
+    for(int i = 0; i < checked; i++){
+        const Polygon& footprint = footprints[i];
+        AABB box = footprint.bounds();
+        bool hit = false;
+        for(const Polygon& rack : racks)
+            if( rack.bounds().overlaps(box) && footprint.intersects(rack) ){ hit = true; break; }
+        for(const sphere& pillar : pillars){
+            if( hit ) break;
+            hit = footprint.contains(pillar.center()) || (footprint.closest_pt_to(pillar.center()) - pillar.center()).r() <= pillar.radius();
+        }
+        naive_hits += hit;
+    }
+    end = high_resolution_clock::now();
+    int filtered_hits = 0;
+    for(int i = 0; i < checked; i++) filtered_hits += filter.intersects(footprints[i].view());
+    cout << "    every obstacle " << duration_cast<nanoseconds>(end - start).count() / double(checked) << " ns per pose, "
+         << naive_hits << " / " << filtered_hits << " collisions in the first " << checked << endl;
+}
+
+void gjk_batch_test(){
+    // 1M pairs drawn from 4096 small convex polygons
+    Scene_generator generator(2026);
+    std::vector<Polygon> polygons;
+    for(int i = 0; i < 4096; i++)
+        polygons.push_back(generator.random_convex(generator.random_point(AABB(v2(-20, -20), v2(20, 20))), generator.uniform(1, 10), generator.integer(3, 8)));
+    const size_t count = 1000000;
+    std::vector<Polygon_view> first, second;
+    for(size_t i = 0; i < count; i++){
+        first.push_back(polygons[generator.integer(0, 4095)].view());
+        second.push_back(polygons[generator.integer(0, 4095)].view());
+    }
+
+    std::unique_ptr<bool[]> hits(new bool[count]), scalar_hits(new bool[count]), lane_hits(new bool[count]);
+    std::vector<double> distances(count), scalar_distances(count), lane_distances(count);
+    auto rate = [&](high_resolution_clock::time_point start, high_resolution_clock::time_point end){
+        return count / (duration_cast<microseconds>(end - start).count() / 1e6) / 1e6;
+    };
+
+    auto t0 = high_resolution_clock::now();
+    for(size_t i = 0; i < count; i++) hits[i] = GJK::intersects(first[i].vertices, first[i].size, second[i].vertices, second[i].size);
+    auto t1 = high_resolution_clock::now();
+    GJK::intersects_batch<1>(first.data(), second.data(), count, scalar_hits.get());
+    auto t2 = high_resolution_clock::now();
+    GJK::intersects_batch(first.data(), second.data(), count, lane_hits.get());
+    auto t3 = high_resolution_clock::now();
+    for(size_t i = 0; i < count; i++) distances[i] = GJK::distance(first[i].vertices, first[i].size, second[i].vertices, second[i].size);
+    auto t4 = high_resolution_clock::now();
+    GJK::distance_batch<1>(first.data(), second.data(), count, scalar_distances.data());
+    auto t5 = high_resolution_clock::now();
+    GJK::distance_batch(first.data(), second.data(), count, lane_distances.data());
+    auto t6 = high_resolution_clock::now();
+
+    int mismatches = 0, overlaps = 0;
+    for(size_t i = 0; i < count; i++){
+        overlaps += hits[i];
+        mismatches += (scalar_hits[i] != hits[i]) + (lane_hits[i] != hits[i]);
+        mismatches += (scalar_distances[i] != distances[i]) + (lane_distances[i] != distances[i]);
+    }
+    cout << count << " pairs, " << overlaps << " overlapping, " << mismatches << " mismatches, " << GJK::BATCH_LANES << " lanes (million pairs per second)" << endl;
+    cout << "    intersects: loop " << rate(t0, t1) << ", batch W = 1 " << rate(t1, t2) << ", batch " << rate(t2, t3) << endl;
+    cout << "    distance:   loop " << rate(t3, t4) << ", batch W = 1 " << rate(t4, t5) << ", batch " << rate(t5, t6) << endl;
+}
+
+void concurrent_scene_test(){
+    // 2000 hexagons; obstacles 2k and 2k + 1 always move together, so a reader that sees only one of them moved saw a torn update
+    std::vector<Polygon> obstacles = grid_obstacles(2000, 11);
+    std::vector<v2> offsets;
+    for(size_t i = 0; i + 1 < obstacles.size(); i += 2)
+        offsets.push_back(obstacles[i + 1].vertices[0] - obstacles[i].vertices[0]);
+    const int readers = 3, moved_per_tick = 20;
+    const auto duration = milliseconds(500);
+
+    // the two ways of sharing a vector<Polygon> today
+    struct Shared_vector{
+        std::vector<Polygon> polygons;
+        std::vector<AABB> boxes;
+        bool intersects(const Polygon& robot) const {
+            AABB box = robot.bounds();
+            for(size_t i = 0; i < polygons.size(); i++)
+                if( boxes[i].overlaps(box) && robot.intersects(polygons[i]) ) return true;
+            return false;
+        }
+        bool torn(size_t pair, const std::vector<v2>& offsets) const {
+            return (polygons[2 * pair + 1].vertices[0] - polygons[2 * pair].vertices[0] - offsets[pair]).r() > 1e-6;
+        }
+        void translate(size_t i, const v2& v){ polygons[i].self_translate(v); boxes[i] = polygons[i].bounds(); }
+    };
+    enum MODE { LOCK, COPY, SNAPSHOT };
+    const char* names[] = {"global lock   ", "copy per tick ", "snapshots     "};
+
+    for(int rate : {0, 100, 1000, -1}){
+        for(MODE mode : {LOCK, COPY, SNAPSHOT}){
+            Shared_vector locked{obstacles, {}};
+            for(const Polygon& p : obstacles) locked.boxes.push_back(p.bounds());
+            std::mutex lock;
+            std::shared_ptr<const Shared_vector> copy = std::make_shared<const Shared_vector>(locked);
+            std::unique_ptr<Concurrent_scene> scene(new Concurrent_scene(obstacles, readers));
+
+            std::atomic<bool> stop(false);
+            std::atomic<long> queries(0), torn(0);
+            long ticks = 0;
+            size_t most_retired = 0;
+
+            std::vector<std::thread> threads;
+            for(int r = 0; r < readers; r++)
+                threads.emplace_back([&, r](){
+                    Scene_generator generator(100 + r);
+                    std::unique_ptr<Concurrent_scene::Reader> reader;
+                    if( mode == SNAPSHOT ) reader.reset(new Concurrent_scene::Reader(*scene));
+                    long count = 0, bad = 0;
+                    while( !stop.load(std::memory_order_relaxed) ){
+                        Polygon robot = generator.random_convex(generator.random_point(AABB(v2(0, 0), v2(450, 450))), 3, 6);
+                        size_t pair = generator.integer(0, (int)offsets.size() - 1);
+                        if( mode == LOCK ){
+                            std::lock_guard<std::mutex> guard(lock);
+                            locked.intersects(robot);
+                            bad += locked.torn(pair, offsets);
+                        }
+                        else if( mode == COPY ){
+                            std::shared_ptr<const Shared_vector> current;
+                            { std::lock_guard<std::mutex> guard(lock); current = copy; }
+                            current->intersects(robot);
+                            bad += current->torn(pair, offsets);
+                        }
+                        else{
+                            Concurrent_scene::Snapshot snapshot = reader->pin();
+                            snapshot.intersects(robot.view());
+                            const Polygon& a = *snapshot[2 * pair];
+                            const Polygon& b = *snapshot[2 * pair + 1];
+                            bad += (b.vertices[0] - a.vertices[0] - offsets[pair]).r() > 1e-6;
+                        }
+                        count++;
+                    }
+                    queries += count;
+                    torn += bad;
+                });
+
+            // the writer: moved_per_tick pairs per tick, `rate` ticks per second (-1: as fast as it can)
+            Scene_generator generator(7);
+            auto start = high_resolution_clock::now();
+            while( high_resolution_clock::now() - start < duration ){
+                if( rate == 0 ){ std::this_thread::sleep_for(milliseconds(10)); continue; }
+                std::vector<std::pair<size_t, v2>> moves;
+                for(int k = 0; k < moved_per_tick; k++)
+                    moves.emplace_back(generator.integer(0, (int)offsets.size() - 1), v2(generator.uniform(-0.1, 0.1), generator.uniform(-0.1, 0.1)));
+                if( mode == LOCK ){
+                    std::lock_guard<std::mutex> guard(lock);
+                    for(auto& move : moves){ locked.translate(2 * move.first, move.second); locked.translate(2 * move.first + 1, move.second); }
+                }
+                else if( mode == COPY ){
+                    std::shared_ptr<Shared_vector> next = std::make_shared<Shared_vector>(*copy);
+                    for(auto& move : moves){ next->translate(2 * move.first, move.second); next->translate(2 * move.first + 1, move.second); }
+                    std::lock_guard<std::mutex> guard(lock);
+                    copy = next;
+                }
+                else{
+                    for(auto& move : moves){ scene->translate(2 * move.first, move.second); scene->translate(2 * move.first + 1, move.second); }
+                    scene->publish();
+                    most_retired = std::max(most_retired, scene->retired_count());
+                }
+                ticks++;
+                if( rate > 0 ) std::this_thread::sleep_until(start + microseconds(1000000 / rate * ticks));
+            }
+            stop = true;
+            for(std::thread& thread : threads) thread.join();
+            double seconds = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1e6;
+
+            cout << (rate < 0 ? std::string("unthrottled") : std::to_string(rate) + " ticks/s") << ", " << names[mode]
+                 << queries / seconds / 1000 << "k queries/s, " << ticks / seconds << " ticks/s, " << torn << " torn reads";
+            if( mode == SNAPSHOT )
+                cout << ", " << scene->reclaimed_count() << " reclaimed, at most " << most_retired << " waiting";
+            cout << endl;
+        }
+    }
+}
+
 int main(int argc, const char * argv[])
 {
     // N2D::render::create_window(500, 500, "Rendering Test", v2(200, 200));
@@ -56,6 +883,24 @@ int main(int argc, const char * argv[])
     // N2D::render::main_loop();
 
     performance_test();
+    // scene_file_test();
+    // polygon_store_test();
+    // sweep_prune_test();
+    // collision_cache_test();
+    // simplify_test();
+    // path_validation_test();
+    // kd_tree_test();
+    // predicates_test();
+    // fixed_polygon_test();
+    // contact_test();
+    // visibility_graph_test();
+    // trace_test();
+    // differential_test();
+    // edge_bvh_test();
+    // lidar_test();
+    // occupancy_test();
+    // gjk_batch_test();
+    // concurrent_scene_test();
 
     return 0;
 }
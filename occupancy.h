@@ -0,0 +1,498 @@
+//
+//  occupancy.h
+//  Naive2D
+//
+//  A conservative prefilter for collision checks. Obstacles are rasterized
+//  into two bitmaps over a grid: a cell is "touched" if some obstacle
+//  overlaps it and "full" if it lies completely inside one. Coarser levels
+//  merge 2 x 2 cells (touched if any is, full if all are), one 64 bit word
+//  covering 64 cells of a row, so a footprint over a large free area is
+//  settled with a few word tests. A footprint is
+//      free        if none of the cells it overlaps is touched,
+//      occupied    if one of its vertices lies in a full cell,
+//      unknown     otherwise, and only then are the obstacles around it
+//                  checked exactly.
+//
+
+#ifndef Naive2D_occupancy_h
+#define Naive2D_occupancy_h
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    enum class OCCUPANCY{ FREE, OCCUPIED, UNKNOWN };
+
+    class Occupancy_bitmap
+    {
+    public:
+        // cells are widened by this fraction of their size so that touching shapes share a cell
+        static constexpr double MARGIN = 1e-9;
+
+        /* A bitmap over region with square cells of cell_size, and levels - 1 coarser levels above it.
+         * Obstacles are added with add(), then build_levels() fills in the coarser levels.
+         */
+        Occupancy_bitmap( const AABB& region, double cell_size, unsigned levels = 6 ) : region(region), cell_size(cell_size)
+        {
+            if( cell_size <= 0.0 || levels == 0 )
+                throw "An occupancy bitmap needs a positive cell size and at least one level.";
+            v2 size = region.max - region.min;
+            unsigned w = std::max(1u, (unsigned)std::ceil(size.x / cell_size));
+            unsigned h = std::max(1u, (unsigned)std::ceil(size.y / cell_size));
+            for( unsigned k = 0; k < levels; k++ )
+            {
+                Level level;
+                level.width = w;
+                level.height = h;
+                level.words = (w + 63) / 64;
+                level.touched.assign((size_t)level.words * h, 0);
+                level.full.assign((size_t)level.words * h, 0);
+                grid.push_back(std::move(level));
+                w = (w + 1) / 2;
+                h = (h + 1) / 2;
+            }
+        }
+
+        unsigned levels() const { return (unsigned)grid.size(); }
+        unsigned width( unsigned level ) const { return grid[level].width; }
+        unsigned height( unsigned level ) const { return grid[level].height; }
+        const AABB& bounds() const { return region; }
+
+        // FREE if no obstacle overlaps the cell, OCCUPIED if it is completely covered, UNKNOWN otherwise.
+        OCCUPANCY cell( unsigned level, unsigned x, unsigned y ) const
+        {
+            const Level& l = grid[level];
+            size_t word = (size_t)y * l.words + x / 64;
+            uint64_t bit = 1ull << (x % 64);
+            if( l.full[word] & bit ) return OCCUPANCY::OCCUPIED;
+            return (l.touched[word] & bit) ? OCCUPANCY::UNKNOWN : OCCUPANCY::FREE;
+        }
+
+        // Rasterizes a polygon, convex or not, into the finest level.
+        void add( const Polygon_view& obstacle )
+        {
+            AABB box = obstacle.bounds();
+            if( !contained(box) ) exceeded = true;
+            int r0, r1, c0, c1;
+            if( !cell_range(box, r0, r1, c0, c1) ) return;
+            Level& level = grid[0];
+
+            // the cells the boundary passes through; they are not full
+            unsigned w0 = c0 / 64, words = c1 / 64 - w0 + 1;
+            std::vector<uint64_t> boundary((size_t)words * (r1 - r0 + 1), 0);
+            for( unsigned i = 0; i < obstacle.size; i++ )
+            {
+                const v2& a = obstacle[i];
+                const v2& b = obstacle[(i + 1) % obstacle.size];
+                int e0 = std::max(r0, row_of(std::min(a.y, b.y) - MARGIN * cell_size));
+                int e1 = std::min(r1, row_of(std::max(a.y, b.y) + MARGIN * cell_size));
+                for( int r = e0; r <= e1; r++ )
+                {
+                    double x_min, x_max;
+                    if( !clip_to_row(a, b, r, x_min, x_max) ) continue;
+                    int x0 = std::max(c0, column_of(x_min - MARGIN * cell_size));
+                    int x1 = std::min(c1, column_of(x_max + MARGIN * cell_size));
+                    if( x0 > x1 ) continue;
+                    set_bits(&boundary[(size_t)(r - r0) * words], x0 - w0 * 64, x1 - w0 * 64);
+                    set_bits(&level.touched[(size_t)r * level.words], x0, x1);
+                }
+            }
+
+            // any other cell is completely inside or completely outside, as its center is
+            std::vector<double> crossings;
+            for( int r = r0; r <= r1; r++ )
+            {
+                double y = region.min.y + (r + 0.5) * cell_size;
+                crossings.clear();
+                for( unsigned i = 0; i < obstacle.size; i++ )
+                {
+                    const v2& a = obstacle[i];
+                    const v2& b = obstacle[(i + 1) % obstacle.size];
+                    if( (a.y > y) != (b.y > y) )
+                        crossings.push_back(a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x));
+                }
+                std::sort(crossings.begin(), crossings.end());
+                uint64_t* touched = &level.touched[(size_t)r * level.words];
+                uint64_t* full = &level.full[(size_t)r * level.words];
+                const uint64_t* edges = &boundary[(size_t)(r - r0) * words];
+                for( size_t k = 0; k + 1 < crossings.size(); k += 2 )
+                {
+                    int x0 = std::max(c0, (int)std::ceil((crossings[k] - region.min.x) / cell_size - 0.5));
+                    int x1 = std::min(c1, (int)std::floor((crossings[k + 1] - region.min.x) / cell_size - 0.5));
+                    for( int w = x0 / 64; x0 <= x1 && w <= x1 / 64; w++ )
+                    {
+                        uint64_t bits = range_mask(w, x0, x1) & ~edges[w - w0];
+                        touched[w] |= bits;
+                        full[w] |= bits;
+                    }
+                }
+            }
+        }
+
+        void add( const Polygon& obstacle ) { add(obstacle.view()); }
+
+        // Rasterizes a sphere into the finest level; L1 and L-infinity spheres as their polygons.
+        void add( const sphere& obstacle )
+        {
+            v2 c = obstacle.center();
+            double r = obstacle.radius();
+            if( obstacle.metric == SPHEREMETRIC::L1 )
+            {
+                std::array<v2, 4> corners{{c + v2(-r, 0), c + v2(0, r), c + v2(r, 0), c + v2(0, -r)}};
+                add(Polygon_view(corners.data(), 4));
+                return;
+            }
+            if( obstacle.metric == SPHEREMETRIC::LINFTY )
+            {
+                std::array<v2, 4> corners{{c + v2(-r, -r), c + v2(-r, r), c + v2(r, r), c + v2(r, -r)}};
+                add(Polygon_view(corners.data(), 4));
+                return;
+            }
+            AABB box(c - v2(r, r), c + v2(r, r));
+            if( !contained(box) ) exceeded = true;
+            int r0, r1, c0, c1;
+            if( !cell_range(box, r0, r1, c0, c1) ) return;
+            Level& level = grid[0];
+            double margin = MARGIN * cell_size;
+            for( int row = r0; row <= r1; row++ )
+            {
+                double y0 = region.min.y + row * cell_size, y1 = y0 + cell_size;
+                double closest = std::max(0.0, std::max(y0 - c.y, c.y - y1)) - margin;
+                double farthest = std::max(std::fabs(y0 - c.y), std::fabs(y1 - c.y)) + margin;
+                if( closest > r ) continue;
+                double outer = std::sqrt(r * r - std::max(0.0, closest) * std::max(0.0, closest)) + margin;
+                int x0 = std::max(c0, column_of(c.x - outer)), x1 = std::min(c1, column_of(c.x + outer));
+                if( x0 <= x1 ) set_bits(&level.touched[(size_t)row * level.words], x0, x1);
+                if( farthest >= r ) continue;
+                // cells whose corners are all inside
+                double inner = std::sqrt(r * r - farthest * farthest) - margin;
+                x0 = std::max(c0, (int)std::ceil((c.x - inner - region.min.x) / cell_size));
+                x1 = std::min(c1, (int)std::floor((c.x + inner - region.min.x) / cell_size) - 1);
+                if( x0 <= x1 ) set_bits(&level.full[(size_t)row * level.words], x0, x1);
+            }
+        }
+
+        // Merges 2 x 2 cells of each level into the level above.
+        void build_levels()
+        {
+            for( unsigned k = 1; k < grid.size(); k++ )
+            {
+                const Level& fine = grid[k - 1];
+                Level& coarse = grid[k];
+                for( unsigned y = 0; y < coarse.height; y++ )
+                {
+                    const uint64_t* t0 = &fine.touched[(size_t)(2 * y) * fine.words];
+                    const uint64_t* f0 = &fine.full[(size_t)(2 * y) * fine.words];
+                    bool pair = 2 * y + 1 < fine.height;
+                    const uint64_t* t1 = pair ? t0 + fine.words : nullptr;
+                    const uint64_t* f1 = pair ? f0 + fine.words : nullptr;
+                    for( unsigned w = 0; w < coarse.words; w++ )
+                    {
+                        uint64_t touched = 0, full = 0;
+                        for( unsigned half = 0; half < 2; half++ )
+                        {
+                            unsigned src = 2 * w + half;
+                            if( src >= fine.words ) break;
+                            uint64_t t = t0[src] | (pair ? t1[src] : 0);
+                            // a cell past the bottom edge lies outside the region and is not full
+                            uint64_t f = pair ? f0[src] & f1[src] : 0;
+                            touched |= compact(t | (t >> 1)) << (32 * half);
+                            full |= compact(f & (f >> 1)) << (32 * half);
+                        }
+                        coarse.touched[(size_t)y * coarse.words + w] = touched;
+                        coarse.full[(size_t)y * coarse.words + w] = full;
+                    }
+                }
+            }
+        }
+
+        // Classifies a footprint, which is covered conservatively by the rows of its edges.
+        OCCUPANCY classify( const Polygon_view& footprint ) const
+        {
+            for( unsigned i = 0; i < footprint.size; i++ )
+            {
+                v2 p = footprint[i];
+                int x = column_of(p.x), y = row_of(p.y);
+                if( x >= 0 && y >= 0 && x < (int)grid[0].width && y < (int)grid[0].height && cell(0, x, y) == OCCUPANCY::OCCUPIED )
+                    return OCCUPANCY::OCCUPIED;
+            }
+
+            AABB box = footprint.bounds();
+            // part of the footprint is outside the grid, where obstacles may not have been drawn
+            if( exceeded && !contained(box) ) return OCCUPANCY::UNKNOWN;
+            int r0, r1, c0, c1;
+            if( !cell_range(box, r0, r1, c0, c1) ) return OCCUPANCY::FREE;
+
+            // the box on the coarsest level it spans at most 2 x 2 cells of, then finer while it is touched
+            unsigned level = 0;
+            while( level + 1 < grid.size() && ((r1 >> level) - (r0 >> level) > 1 || (c1 >> level) - (c0 >> level) > 1) )
+                level++;
+            for( ; ; level-- )
+            {
+                if( !any_touched(level, r0 >> level, r1 >> level, c0 >> level, c1 >> level) )
+                    return OCCUPANCY::FREE;
+                if( level == 0 ) break;
+            }
+
+            // the finest level, row by row along the footprint itself
+            double margin = MARGIN * cell_size;
+            for( int r = r0; r <= r1; r++ )
+            {
+                double x_min = MAX_DOUBLE, x_max = -MAX_DOUBLE;
+                for( unsigned i = 0; i < footprint.size; i++ )
+                {
+                    double lo, hi;
+                    if( clip_to_row(footprint[i], footprint[(i + 1) % footprint.size], r, lo, hi) )
+                    {
+                        x_min = std::min(x_min, lo);
+                        x_max = std::max(x_max, hi);
+                    }
+                }
+                if( x_min > x_max ) continue;
+                int x0 = std::max(c0, column_of(x_min - margin)), x1 = std::min(c1, column_of(x_max + margin));
+                if( x0 <= x1 && any_touched(0, r, r, x0, x1) )
+                    return OCCUPANCY::UNKNOWN;
+            }
+            return OCCUPANCY::FREE;
+        }
+
+        OCCUPANCY classify( const Polygon& footprint ) const { return classify(footprint.view()); }
+
+    private:
+        struct Level
+        {
+            unsigned width = 0, height = 0, words = 0;     // cells, and 64 bit words per row
+            std::vector<uint64_t> touched, full;
+        };
+
+        AABB region;
+        double cell_size;
+        std::vector<Level> grid;        // grid[0] is the finest
+        bool exceeded = false;          // some obstacle reaches outside the region
+
+        int column_of( double x ) const { return (int)std::floor((x - region.min.x) / cell_size); }
+        int row_of( double y ) const { return (int)std::floor((y - region.min.y) / cell_size); }
+
+        bool contained( const AABB& box ) const
+        {
+            return box.min.x >= region.min.x && box.min.y >= region.min.y && box.max.x <= region.max.x && box.max.y <= region.max.y;
+        }
+
+        // the cells of the finest level a box overlaps, clipped to the grid; false if none
+        bool cell_range( const AABB& box, int& r0, int& r1, int& c0, int& c1 ) const
+        {
+            double margin = MARGIN * cell_size;
+            r0 = std::max(0, row_of(box.min.y - margin));
+            r1 = std::min((int)grid[0].height - 1, row_of(box.max.y + margin));
+            c0 = std::max(0, column_of(box.min.x - margin));
+            c1 = std::min((int)grid[0].width - 1, column_of(box.max.x + margin));
+            return r0 <= r1 && c0 <= c1;
+        }
+
+        // the x range of segment ab within row r, widened by the margin; false if it misses the row
+        bool clip_to_row( const v2& a, const v2& b, int r, double& x_min, double& x_max ) const
+        {
+            double margin = MARGIN * cell_size;
+            double y0 = region.min.y + r * cell_size - margin, y1 = region.min.y + (r + 1) * cell_size + margin;
+            double t0 = 0.0, t1 = 1.0, dy = b.y - a.y;
+            if( dy == 0.0 )
+            {
+                if( a.y < y0 || a.y > y1 ) return false;
+            }
+            else
+            {
+                double s0 = (y0 - a.y) / dy, s1 = (y1 - a.y) / dy;
+                if( s0 > s1 ) std::swap(s0, s1);
+                t0 = std::max(t0, s0);
+                t1 = std::min(t1, s1);
+                if( t0 > t1 ) return false;
+            }
+            double xa = a.x + (b.x - a.x) * t0, xb = a.x + (b.x - a.x) * t1;
+            x_min = std::min(xa, xb);
+            x_max = std::max(xa, xb);
+            return true;
+        }
+
+        bool any_touched( unsigned level, int r0, int r1, int c0, int c1 ) const
+        {
+            const Level& l = grid[level];
+            for( int r = r0; r <= r1; r++ )
+            {
+                const uint64_t* row = &l.touched[(size_t)r * l.words];
+                for( int w = c0 / 64; w <= c1 / 64; w++ )
+                    if( row[w] & range_mask(w, c0, c1) ) return true;
+            }
+            return false;
+        }
+
+        // the bits of word w that are columns x0 .. x1
+        static uint64_t range_mask( int w, int x0, int x1 )
+        {
+            int lo = std::max(x0 - w * 64, 0), hi = std::min(x1 - w * 64, 63);
+            uint64_t upper = hi == 63 ? ~0ull : (1ull << (hi + 1)) - 1;
+            return upper & ~((1ull << lo) - 1);
+        }
+
+        static void set_bits( uint64_t* row, int x0, int x1 )
+        {
+            for( int w = x0 / 64; w <= x1 / 64; w++ )
+                row[w] |= range_mask(w, x0, x1);
+        }
+
+        // gathers the even bits of x into the low 32 bits
+        static uint64_t compact( uint64_t x )
+        {
+            x &= 0x5555555555555555ull;
+            x = (x | (x >> 1)) & 0x3333333333333333ull;
+            x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+            x = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+            x = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+            return (x | (x >> 16)) & 0x00000000ffffffffull;
+        }
+    };
+
+    /* Collision checks of convex footprints against convex polygons and spheres, with an occupancy
+     * bitmap in front. Only footprints the bitmap cannot settle are checked exactly, against the
+     * obstacles listed in the buckets they overlap. The obstacles are referenced, not copied.
+     */
+    class Occupancy_filter
+    {
+    public:
+        // bucket cells are 2^BUCKET_LEVEL bitmap cells wide
+        static constexpr unsigned BUCKET_LEVEL = 3;
+
+        Occupancy_filter( const std::vector<Polygon>& polygons, const std::vector<sphere>& spheres, double cell_size, unsigned levels = 6 )
+            : polygons(polygons), spheres(spheres), occupancy(scene_bounds(polygons, spheres, cell_size), cell_size, levels)
+        {
+            for( const Polygon& polygon : polygons ) occupancy.add(polygon);
+            for( const sphere& s : spheres ) occupancy.add(s);
+            occupancy.build_levels();
+
+            double bucket_size = cell_size * (1 << BUCKET_LEVEL);
+            origin = occupancy.bounds().min;
+            columns = (unsigned)std::ceil((occupancy.bounds().max.x - origin.x) / bucket_size) + 1;
+            rows = (unsigned)std::ceil((occupancy.bounds().max.y - origin.y) / bucket_size) + 1;
+            inverse = 1.0 / bucket_size;
+
+            // counting sort of the obstacles into the buckets their boxes overlap
+            size_t n = polygons.size() + spheres.size();
+            ranges.resize(n);
+            for( size_t i = 0; i < n; i++ ) ranges[i] = bucket_range(obstacle_bounds(i));
+            starts.assign((size_t)columns * rows + 1, 0);
+            for( const Range& range : ranges )
+                for( unsigned y = range.y0; y <= range.y1; y++ )
+                    for( unsigned x = range.x0; x <= range.x1; x++ )
+                        starts[(size_t)y * columns + x + 1]++;
+            for( size_t b = 0; b + 1 < starts.size(); b++ ) starts[b + 1] += starts[b];
+            entries.resize(starts.back());
+            std::vector<uint32_t> fill(starts.begin(), starts.end() - 1);
+            for( size_t i = 0; i < n; i++ )
+                for( unsigned y = ranges[i].y0; y <= ranges[i].y1; y++ )
+                    for( unsigned x = ranges[i].x0; x <= ranges[i].x1; x++ )
+                        entries[fill[(size_t)y * columns + x]++] = (uint32_t)i;
+        }
+
+        const Occupancy_bitmap& bitmap() const { return occupancy; }
+
+        OCCUPANCY classify( const Polygon_view& footprint ) const { return occupancy.classify(footprint); }
+
+        // Whether a convex footprint intersects any obstacle; the same answer as checking them all.
+        bool intersects( const Polygon_view& footprint ) const
+        {
+            switch( occupancy.classify(footprint) )
+            {
+                case OCCUPANCY::FREE: return false;
+                case OCCUPANCY::OCCUPIED: return true;
+                default: break;
+            }
+            AABB box = footprint.bounds();
+            Range query = bucket_range(box);
+            for( unsigned y = query.y0; y <= query.y1; y++ )
+                for( unsigned x = query.x0; x <= query.x1; x++ )
+                {
+                    size_t b = (size_t)y * columns + x;
+                    for( uint32_t k = starts[b]; k < starts[b + 1]; k++ )
+                    {
+                        uint32_t i = entries[k];
+                        // visit an obstacle only in the first bucket it shares with the query
+                        if( std::max(ranges[i].x0, query.x0) != x || std::max(ranges[i].y0, query.y0) != y ) continue;
+                        if( !obstacle_bounds(i).overlaps(box) ) continue;
+                        if( exact(footprint, i) ) return true;
+                    }
+                }
+            return false;
+        }
+
+        bool intersects( const Polygon& footprint ) const { return intersects(footprint.view()); }
+
+    private:
+        struct Range { unsigned x0, y0, x1, y1; };
+
+        const std::vector<Polygon>& polygons;
+        const std::vector<sphere>& spheres;
+        Occupancy_bitmap occupancy;
+        v2 origin;
+        double inverse;
+        unsigned columns, rows;
+        std::vector<Range> ranges;          // the buckets of each obstacle, polygons first
+        std::vector<uint32_t> starts;       // bucket b lists entries[starts[b] .. starts[b + 1])
+        std::vector<uint32_t> entries;
+
+        static AABB sphere_bounds( const sphere& s )
+        {
+            v2 r(s.radius(), s.radius());
+            return AABB(s.center() - r, s.center() + r);
+        }
+
+        // all the obstacles and one cell around them
+        static AABB scene_bounds( const std::vector<Polygon>& polygons, const std::vector<sphere>& spheres, double cell_size )
+        {
+            AABB box;
+            for( const Polygon& polygon : polygons ) box.expand(polygon.bounds());
+            for( const sphere& s : spheres ) box.expand(sphere_bounds(s));
+            if( box.empty() ) box = AABB(v2(0, 0), v2(0, 0));
+            return AABB(box.min - v2(cell_size, cell_size), box.max + v2(cell_size, cell_size));
+        }
+
+        AABB obstacle_bounds( size_t i ) const
+        {
+            return i < polygons.size() ? polygons[i].bounds() : sphere_bounds(spheres[i - polygons.size()]);
+        }
+
+        Range bucket_range( const AABB& box ) const
+        {
+            auto clamp = [](double v, unsigned n){ return (unsigned)std::min(std::max(v, 0.0), (double)(n - 1)); };
+            return Range{clamp((box.min.x - origin.x) * inverse, columns), clamp((box.min.y - origin.y) * inverse, rows),
+                         clamp((box.max.x - origin.x) * inverse, columns), clamp((box.max.y - origin.y) * inverse, rows)};
+        }
+
+        bool exact( const Polygon_view& footprint, size_t i ) const
+        {
+            if( i < polygons.size() )
+                return footprint.intersects(polygons[i].view());
+            const sphere& s = spheres[i - polygons.size()];
+            v2 c = s.center();
+            double r = s.radius();
+            if( s.metric == SPHEREMETRIC::L1 )
+            {
+                std::array<v2, 4> corners{{c + v2(-r, 0), c + v2(0, r), c + v2(r, 0), c + v2(0, -r)}};
+                return footprint.intersects(Polygon_view(corners.data(), 4));
+            }
+            if( s.metric == SPHEREMETRIC::LINFTY )
+            {
+                std::array<v2, 4> corners{{c + v2(-r, -r), c + v2(-r, r), c + v2(r, r), c + v2(r, -r)}};
+                return footprint.intersects(Polygon_view(corners.data(), 4));
+            }
+            return footprint.contains(c) || (footprint.closest_pt_to(c) - c).r() <= r;
+        }
+    };
+}
+
+#endif
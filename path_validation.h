@@ -0,0 +1,134 @@
+//
+//  path_validation.h
+//  Naive2D
+//
+//  Exact validation of piecewise linear paths of a translating convex robot.
+//  For pure translation from p to q, the area the robot sweeps is the convex
+//  hull of the robot at p and the robot at q. Its support point in a direction
+//  is the robot's support point plus whichever of p, q is farther along that
+//  direction, so GJK tests the whole motion at once without stepping it.
+//
+
+#ifndef Naive2D_path_validation_h
+#define Naive2D_path_validation_h
+
+#include <atomic>
+#include <climits>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "GJK_utility.h"
+
+namespace N2D {
+
+    /* Returns true if the robot, translated from `from` to `to`, touches the obstacle anywhere
+     * along the way. Both the robot and the obstacle have to be convex.
+     * @param robot: the robot with its reference point at the origin
+     */
+    static inline bool sweep_intersects( const Polygon_view& robot, const v2& from, const v2& to, const Polygon_view& obstacle )
+    {
+        return GJK::intersects_support([&](const v2& dir){
+            v2 offset = from.dot(dir) >= to.dot(dir) ? from : to;
+            return GJK::farest_point_in_dir(robot.vertices, robot.size, dir) + offset
+                 - GJK::farest_point_in_dir(obstacle.vertices, obstacle.size, -dir);
+        });
+    }
+
+    /* Checks paths of a convex robot against a fixed set of convex obstacles.
+     * The obstacles are referenced, not copied, and must outlive the validator.
+     */
+    class Path_validator
+    {
+    public:
+        explicit Path_validator( const std::vector<Polygon>& obstacles ) : obstacles(obstacles)
+        {
+            bounds.reserve(obstacles.size());
+            for( const Polygon& obstacle : obstacles )
+                bounds.push_back(obstacle.bounds());
+        }
+
+        // Call after the obstacles moved, were added or were removed.
+        void update_bounds()
+        {
+            bounds.resize(obstacles.size());
+            for( size_t i = 0; i < obstacles.size(); i++ )
+                bounds[i] = obstacles[i].bounds();
+        }
+
+        /* Returns true if the robot can translate from `from` to `to` without touching an obstacle.
+         * @param robot: the robot with its reference point at the origin
+         */
+        bool segment_free( const Polygon_view& robot, const v2& from, const v2& to ) const
+        {
+            AABB robot_box = robot.bounds();
+            AABB swept(robot_box.min + v2(std::min(from.x, to.x), std::min(from.y, to.y)),
+                       robot_box.max + v2(std::max(from.x, to.x), std::max(from.y, to.y)));
+            check_bounds();
+            return segment_free(robot, from, to, swept);
+        }
+
+        /* Returns the index k of the first path segment path[k] -> path[k+1] on which the robot
+         * collides, or -1 if the whole path is free. Segments are checked in parallel; segments
+         * after an already found collision are skipped.
+         * @param robot: the robot with its reference point at the origin
+         * @param path: the positions of the reference point
+         */
+        int first_collision( const Polygon_view& robot, const std::vector<v2>& path ) const
+        {
+            int segments = (int)path.size() - 1;
+            if( segments < 1 )
+            {
+                if( path.size() == 1 && !segment_free(robot, path[0], path[0]) ) return 0;
+                return -1;
+            }
+            check_bounds();
+            AABB robot_box = robot.bounds();
+            std::atomic<int> first(INT_MAX);
+
+            #pragma omp parallel for schedule(dynamic, 16)
+            for( int k = 0; k < segments; k++ )
+            {
+                if( k > first.load(std::memory_order_relaxed) ) continue;
+                const v2& from = path[k];
+                const v2& to = path[k + 1];
+                AABB swept(robot_box.min + v2(std::min(from.x, to.x), std::min(from.y, to.y)),
+                           robot_box.max + v2(std::max(from.x, to.x), std::max(from.y, to.y)));
+                if( segment_free(robot, from, to, swept) ) continue;
+                int current = first.load();
+                while( k < current && !first.compare_exchange_weak(current, k) ) {}
+            }
+            int result = first.load();
+            return result == INT_MAX ? -1 : result;
+        }
+
+        int first_collision( const Polygon& robot, const std::vector<v2>& path ) const { return first_collision(robot.view(), path); }
+
+        bool path_free( const Polygon_view& robot, const std::vector<v2>& path ) const { return first_collision(robot, path) < 0; }
+
+        bool path_free( const Polygon& robot, const std::vector<v2>& path ) const { return first_collision(robot.view(), path) < 0; }
+
+    private:
+        const std::vector<Polygon>& obstacles;
+        std::vector<AABB> bounds;
+
+        // checked outside of the parallel loop, an exception must not escape an OpenMP region
+        void check_bounds() const
+        {
+            if( bounds.size() != obstacles.size() )
+                throw "Path_validator: the number of obstacles changed, call update_bounds().";
+        }
+
+        bool segment_free( const Polygon_view& robot, const v2& from, const v2& to, const AABB& swept ) const
+        {
+            for( size_t i = 0; i < obstacles.size(); i++ )
+            {
+                if( !swept.overlaps(bounds[i]) ) continue;
+                if( sweep_intersects(robot, from, to, obstacles[i].view()) ) return false;
+            }
+            return true;
+        }
+    };
+}
+
+#endif
@@ -17,62 +17,89 @@
 #include "GJK_utility.h"
 
 namespace N2D {
-    // Or maybe I should changed the name to convex.
-    struct Polygon
+    /* A polygon that does not own its vertices, e.g. a polygon stored in a memory
+     * mapped scene or in a shared vertex pool. All the queries live here so that
+     * they run on any contiguous vertex array without copying it; Polygon simply
+     * forwards to its own view.
+     */
+    struct Polygon_view
     {
-        std::vector<v2> vertices;
+        const v2* vertices;
+        unsigned size;
         
         // Please make sure the order of these points are clockwise.
-        Polygon(std::vector<v2>&& points) : vertices(std::move(points)) { vertices.shrink_to_fit(); }
-       
-        // Please make sure the order of these points are clockwise.
-        Polygon(const v2* points, int n) : vertices(points, points+n) { vertices.shrink_to_fit(); }
+        Polygon_view(const v2* points, unsigned n) : vertices(points), size(n) {}
         
-        // translate.
-        void self_translate( const v2& vect )
+        const v2& operator[](unsigned i) const { return vertices[i]; }
+        
+        const v2* begin() const { return vertices; }
+        const v2* end() const { return vertices + size; }
+        
+        // the axis aligned bounding box of the polygon
+        AABB bounds() const
         {
-            int size = (int)vertices.size();
-            for(int i = 0; i < size; i++)
-            {
-                vertices[i] += vect;
-            }
+            AABB box;
+            for(unsigned int i = 0; i < size; i++)
+                box.expand(vertices[i]);
+            return box;
         }
         
-        // rotate self.
-        void self_rotate( double dtheta, const v2& center )
+        // returns true if the polygon contains the point. Points on the boundary are contained.
+        // Counts the edges crossing the horizontal ray to the right of the point, with exact orientation tests.
+        bool contains(const v2& point) const
         {
-            double cos_dtheta = cos(dtheta);
-            double sin_dtheta = sin(dtheta);
-            int size = (int)vertices.size();
-            for(int i = 0; i < size; i++)
+            N2D_TRACE_SPAN("Polygon::contains");
+            // Without branches per edge: every edge's filtered orientation is computed, and only the edges
+            // that cross the ray's line count. Points level with a vertex, or with an uncertain sign on a
+            // crossing edge (on or next to the boundary), take the exact loop instead.
+            // (int counters rather than bools, so that the loop vectorizes)
+            int crossings = 0, special = 0;
+            auto edge = [&](const v2& a, const v2& b)
             {
-                v2 temp = vertices[i]-center;
-                vertices[i].x = ( temp.x * cos_dtheta - temp.y * sin_dtheta ) + center.x;
-                vertices[i].y = ( temp.x * sin_dtheta + temp.y * cos_dtheta ) + center.y;
-            }
+                int a_above = a.y > point.y, b_above = b.y > point.y;
+                int crosses = a_above ^ b_above;
+                double bound;
+                double o = predicates::orient2d_fast(a.x, a.y, b.x, b.y, point.x, point.y, bound);
+                special |= (a.y == point.y) | (crosses & (std::fabs(o) <= bound));
+                crossings += crosses & ((o > 0.0) == b_above);
+            };
+            if( size == 0 ) return false;
+            for(unsigned int i = 1; i < size; i++)
+                edge(this->vertices[i - 1], this->vertices[i]);
+            edge(this->vertices[size - 1], this->vertices[0]);
+            if( special )
+                return contains_exact(point);
+            return crossings & 1;
         }
         
-        // returns true if the polygon contains the point
-        bool contains(const v2& point) const
+        // contains() one edge at a time, with exact signs and the boundary checked explicitly.
+        N2D_COLD bool contains_exact(const v2& point) const
         {
-            Line_segment ray( point, v2(300000, 300000) );
-            int intersectTimes = 0;
-            unsigned size = (unsigned)vertices.size();
-            for(unsigned int i = 0; i < size; i++)
+            bool inside = false;
+            for(unsigned int i = 0, j = size - 1; i < size; j = i++)
             {
-                Line_segment line(this->vertices[i], this->vertices[(i + 1)% size]);
-                if( line.intersects(ray) )
-                    intersectTimes++;
+                const v2& a = this->vertices[j];
+                const v2& b = this->vertices[i];
+                bool a_above = a.y > point.y, b_above = b.y > point.y;
+                bool in_y_range = a_above != b_above || a.y == point.y || b.y == point.y;
+                if( !in_y_range || point.x > std::max(a.x, b.x) )
+                    continue;
+                double o = predicates::orient2d(a.x, a.y, b.x, b.y, point.x, point.y);
+                if( o == 0.0 && predicates::in_box(a.x, a.y, b.x, b.y, point.x, point.y) )
+                    return true;
+                // half open rule: an edge counts if it crosses the ray's line strictly on one side
+                if( a_above != b_above && (b_above ? o > 0.0 : o < 0.0) )
+                    inside = !inside;
             }
-            return intersectTimes & 1;
+            return inside;
         }
         
         // returns true if the polygon intersects with the line
         bool intersects( const Line_segment& line ) const
         {
+            N2D_TRACE_SPAN("Polygon::intersects_line");
             if( this->contains(line.start) || this->contains(line.end) )
                 return true;
-            unsigned size = (unsigned)vertices.size();
             for(unsigned int i = 0; i < size; i++)
             {
                 Line_segment li(this->vertices[i], this->vertices[(i + 1)% size]);
@@ -84,27 +111,30 @@ namespace N2D {
         
         // Returns true if it intersects with another polygon.
         // (Given that self and other are both convices, if not, please use naive_intersects)
-        bool intersects( const Polygon& other ) const
+        bool intersects( const Polygon_view& other ) const
         {
-            return GJK::intersects( this->vertices, other.vertices );
+            N2D_TRACE_SPAN("Polygon::intersects");
+            return GJK::intersects( this->vertices, this->size, other.vertices, other.size );
         }
         
-        bool naive_intersects( const Polygon& other ) const
+        // Works for non-convex polygons too: either an edge of other touches self,
+        // or self lies completely inside other.
+        bool naive_intersects( const Polygon_view& other ) const
         {
-            unsigned size = (unsigned)vertices.size();
-            for(unsigned int i = 0; i < size; i++)
+            N2D_TRACE_SPAN("Polygon::naive_intersects");
+            for(unsigned int i = 0; i < other.size; i++)
             {
-                Line_segment line(this->vertices[i], this->vertices[(i + 1) % size]);
+                Line_segment line(other.vertices[i], other.vertices[(i + 1) % other.size]);
                 if(this->intersects(line) ) return true;
             }
-            return false;
+            return other.contains(this->vertices[0]);
         }
         
         // How much deep is a point inside the polygon?
         double penetration( const v2 pt ) const
         {
+            N2D_TRACE_SPAN("Polygon::penetration");
             double min = std::numeric_limits<double>::infinity();
-            unsigned size = (unsigned)vertices.size();
             for(unsigned int i = 0; i < size; i++)
             {
                 Line_segment li(this->vertices[i], this->vertices[(i + 1) % size]);
@@ -117,11 +147,11 @@ namespace N2D {
         // Returns the distance to a point
         double distance_to(const v2& pt) const
         {
+            N2D_TRACE_SPAN("Polygon::distance_to_point");
             if(this->contains(pt))
                 return 0.0;
             
             double min = MAX_DOUBLE;
-            unsigned size = (unsigned)vertices.size();
             for(unsigned int i = 0; i < size; i++)
             {
                 Line_segment li(this->vertices[i], this->vertices[(i + 1) % size]);
@@ -133,8 +163,8 @@ namespace N2D {
         // The distance to a line segment.
         double distance_to(const Line_segment& line) const
         {
+            N2D_TRACE_SPAN("Polygon::distance_to_line");
             double min = std::numeric_limits<double>::infinity();
-            unsigned size = (unsigned)vertices.size();
             for(unsigned int i = 0; i < size; i++)
             {
                 Line_segment li(this->vertices[i], this->vertices[(i + 1) % size]);
@@ -145,23 +175,24 @@ namespace N2D {
         
         // If your polygon is a convex, so is other, this function applies GJK algorithm which can be very fast.
         // Otherwise, please use "naive_distance_to" method
-        double distance_to( const Polygon& other ) const
+        double distance_to( const Polygon_view& other ) const
         {
+            N2D_TRACE_SPAN("Polygon::distance_to");
             if( this->intersects(other) ) return 0.0;
-            return GJK::distance(this->vertices, other.vertices);
+            return GJK::distance(this->vertices, this->size, other.vertices, other.size);
         }
         
         // This method loop over all line segments of the polygon and other to test min distance
         // That's why it is naive.
-        double naive_distance_to(const Polygon& other ) const
+        double naive_distance_to(const Polygon_view& other ) const
         {
+            N2D_TRACE_SPAN("Polygon::naive_distance_to");
             if( this->naive_intersects(other) )
                 return 0.0;
             double min = MAX_DOUBLE;
-            unsigned size = (unsigned)vertices.size();
-            for(unsigned int i = 1; i < size; i++)
+            for(unsigned int i = 0; i < other.size; i++)
             {
-                Line_segment line(this->vertices[i], this->vertices[(i + 1) % size]);
+                Line_segment line(other.vertices[i], other.vertices[(i + 1) % other.size]);
                 min = std::min( min, this->distance_to(line) );
             }
             return min;
@@ -171,10 +202,10 @@ namespace N2D {
          */
         v2 closest_pt_to( const v2& point ) const
         {
+            N2D_TRACE_SPAN("Polygon::closest_pt_to");
             v2 nearest;
             double min_dist = std::numeric_limits<double>::infinity();
             
-            unsigned size = (unsigned)vertices.size();
             for(unsigned int i = 0; i < size; i++)
             {
                 Line_segment line(this->vertices[i], this->vertices[(i + 1) % size]);
@@ -190,7 +221,83 @@ namespace N2D {
         }
     };
     
+    // Or maybe I should changed the name to convex.
+    struct Polygon
+    {
+        std::vector<v2> vertices;
+        
+        // Please make sure the order of these points are clockwise.
+        Polygon(std::vector<v2>&& points) : vertices(std::move(points)) { vertices.shrink_to_fit(); }
+       
+        // Please make sure the order of these points are clockwise.
+        Polygon(const v2* points, int n) : vertices(points, points+n) { vertices.shrink_to_fit(); }
+        
+        // Copies the vertices of a view.
+        explicit Polygon(const Polygon_view& view) : vertices(view.begin(), view.end()) {}
+        
+        // a non-owning view of the vertices. Invalidated if vertices reallocates.
+        Polygon_view view() const { return Polygon_view(vertices.data(), (unsigned)vertices.size()); }
+        
+        // translate.
+        void self_translate( const v2& vect )
+        {
+            int size = (int)vertices.size();
+            for(int i = 0; i < size; i++)
+            {
+                vertices[i] += vect;
+            }
+        }
+        
+        // rotate self.
+        void self_rotate( double dtheta, const v2& center )
+        {
+            double cos_dtheta = cos(dtheta);
+            double sin_dtheta = sin(dtheta);
+            int size = (int)vertices.size();
+            for(int i = 0; i < size; i++)
+            {
+                v2 temp = vertices[i]-center;
+                vertices[i].x = ( temp.x * cos_dtheta - temp.y * sin_dtheta ) + center.x;
+                vertices[i].y = ( temp.x * sin_dtheta + temp.y * cos_dtheta ) + center.y;
+            }
+        }
+        
+        AABB bounds() const { return view().bounds(); }
+        
+        // returns true if the polygon contains the point
+        bool contains(const v2& point) const { return view().contains(point); }
+        
+        // returns true if the polygon intersects with the line
+        bool intersects( const Line_segment& line ) const { return view().intersects(line); }
+        
+        // Returns true if it intersects with another polygon.
+        // (Given that self and other are both convices, if not, please use naive_intersects)
+        bool intersects( const Polygon& other ) const { return view().intersects(other.view()); }
+        
+        bool naive_intersects( const Polygon& other ) const { return view().naive_intersects(other.view()); }
+        
+        // How much deep is a point inside the polygon?
+        double penetration( const v2 pt ) const { return view().penetration(pt); }
+        
+        // Returns the distance to a point
+        double distance_to(const v2& pt) const { return view().distance_to(pt); }
+        
+        // The distance to a line segment.
+        double distance_to(const Line_segment& line) const { return view().distance_to(line); }
+        
+        // If your polygon is a convex, so is other, this function applies GJK algorithm which can be very fast.
+        // Otherwise, please use "naive_distance_to" method
+        double distance_to( const Polygon& other ) const { return view().distance_to(other.view()); }
+        
+        // This method loop over all line segments of the polygon and other to test min distance
+        // That's why it is naive.
+        double naive_distance_to(const Polygon& other ) const { return view().naive_distance_to(other.view()); }
+        
+        /* return this closest point to the given point
+         */
+        v2 closest_pt_to( const v2& point ) const { return view().closest_pt_to(point); }
+    };
+    
 }
 
-
 #endif
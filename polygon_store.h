@@ -0,0 +1,213 @@
+//
+//  polygon_store.h
+//  Naive2D
+//
+//  Keeps the vertices of many polygons in one contiguous pool instead of one
+//  heap block per Polygon. Polygons are referred to by a stable id; the id
+//  resolves to an (offset, count) handle into the pool and to a Polygon_view,
+//  so every Polygon query and GJK function runs on stored polygons directly.
+//
+
+#ifndef Naive2D_polygon_store_h
+#define Naive2D_polygon_store_h
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    // Where a polygon lives in the pool.
+    struct Polygon_handle
+    {
+        uint32_t offset;    // index of the first vertex
+        uint32_t count;     // number of vertices, 0 once removed
+    };
+
+    class Polygon_store
+    {
+    public:
+        typedef uint32_t id_type;
+
+        Polygon_store() = default;
+
+        // Reserve room for a number of polygons and their total number of vertices.
+        void reserve( size_t polygons, size_t vertices )
+        {
+            handles.reserve(polygons);
+            pool.reserve(vertices);
+        }
+
+        // number of ids handed out so far, including removed polygons
+        size_t size() const { return handles.size(); }
+
+        // vertices in the pool, including the ones of removed polygons
+        size_t vertex_count() const { return pool.size(); }
+
+        // vertices which belong to removed or replaced polygons and are reclaimed by compact()
+        size_t garbage_count() const { return garbage; }
+
+        bool alive( id_type id ) const { return id < handles.size() && handles[id].count > 0; }
+
+        const Polygon_handle& handle( id_type id ) const { assert(id < handles.size()); return handles[id]; }
+
+        // The polygon as a view into the pool. Invalidated by any insertion or compact().
+        Polygon_view view( id_type id ) const
+        {
+            const Polygon_handle& h = handle(id);
+            return Polygon_view(pool.data() + h.offset, h.count);
+        }
+
+        Polygon_view operator[]( id_type id ) const { return view(id); }
+
+        // the whole vertex pool, e.g. for whole-scene passes
+        const std::vector<v2>& vertices() const { return pool; }
+
+        // Please make sure the order of these points are clockwise.
+        id_type add( const v2* points, unsigned n )
+        {
+            assert(n > 0);
+            Polygon_handle h;
+            h.offset = append(points, n);
+            h.count  = n;
+            handles.push_back(h);
+            return (id_type)(handles.size() - 1);
+        }
+
+        id_type add( const Polygon_view& polygon ) { return add(polygon.vertices, polygon.size); }
+
+        id_type add( const Polygon& polygon ) { return add(polygon.view()); }
+
+        // Bulk insertion with at most one reallocation of the pool. Returns the id of the first polygon;
+        // the rest get consecutive ids.
+        id_type add( const std::vector<Polygon>& polygons )
+        {
+            size_t total = 0;
+            for( const Polygon& polygon : polygons )
+                total += polygon.vertices.size();
+            // grow geometrically, so that many small bulk adds stay linear overall
+            size_t needed_handles = handles.size() + polygons.size(), needed_vertices = pool.size() + total;
+            if( needed_handles > handles.capacity() )
+                handles.reserve(std::max(handles.capacity() * 2, needed_handles));
+            if( needed_vertices > pool.capacity() )
+                pool.reserve(std::max(pool.capacity() * 2, needed_vertices));
+
+            id_type first = (id_type)handles.size();
+            for( const Polygon& polygon : polygons )
+                add(polygon);
+            return first;
+        }
+
+        // Replace the vertices of a polygon. Done in place if the vertex count does not change,
+        // otherwise the new vertices are appended and the old ones become garbage.
+        void set( id_type id, const v2* points, unsigned n )
+        {
+            assert(alive(id) && n > 0);
+            Polygon_handle& h = handles[id];
+            if( h.count == n )
+            {
+                if( points != pool.data() + h.offset )
+                    std::copy(points, points + n, pool.begin() + h.offset);
+                return;
+            }
+            uint32_t offset = append(points, n);
+            garbage += h.count;
+            h.offset = offset;
+            h.count  = n;
+        }
+
+        void remove( id_type id )
+        {
+            assert(alive(id));
+            garbage += handles[id].count;
+            handles[id].count = 0;
+        }
+
+        // Moves the live polygons together, in id order, and releases the garbage.
+        // Ids stay valid, handles and views do not.
+        void compact()
+        {
+            if( garbage == 0 ) return;
+            // polygons may be out of order in the pool after set(), so copy instead of sliding in place.
+            std::vector<v2> packed;
+            packed.reserve(pool.size() - garbage);
+            for( Polygon_handle& h : handles )
+            {
+                if( h.count == 0 ) continue;
+                uint32_t offset = (uint32_t)packed.size();
+                packed.insert(packed.end(), pool.begin() + h.offset, pool.begin() + h.offset + h.count);
+                h.offset = offset;
+            }
+            pool.swap(packed);
+            garbage = 0;
+        }
+
+        void clear()
+        {
+            pool.clear();
+            handles.clear();
+            garbage = 0;
+        }
+
+        // translate a polygon.
+        void self_translate( id_type id, const v2& vect )
+        {
+            const Polygon_handle& h = handle(id);
+            v2* vertices = pool.data() + h.offset;
+            for(unsigned i = 0; i < h.count; i++)
+                vertices[i] += vect;
+        }
+
+        // rotate a polygon.
+        void self_rotate( id_type id, double dtheta, const v2& center )
+        {
+            double cos_dtheta = cos(dtheta);
+            double sin_dtheta = sin(dtheta);
+            const Polygon_handle& h = handle(id);
+            v2* vertices = pool.data() + h.offset;
+            for(unsigned i = 0; i < h.count; i++)
+            {
+                v2 temp = vertices[i]-center;
+                vertices[i].x = ( temp.x * cos_dtheta - temp.y * sin_dtheta ) + center.x;
+                vertices[i].y = ( temp.x * sin_dtheta + temp.y * cos_dtheta ) + center.y;
+            }
+        }
+
+        // Copies a stored polygon out into an owning Polygon.
+        Polygon to_polygon( id_type id ) const { return Polygon(view(id)); }
+
+    private:
+        // Appends n points to the pool and returns their offset. The points may be a view into the pool itself.
+        uint32_t append( const v2* points, unsigned n )
+        {
+            if( pool.size() + n > UINT32_MAX )
+                throw "Polygon_store: the vertex pool is full.";
+            uint32_t offset = (uint32_t)pool.size();
+            std::less<const v2*> before;
+            if( !before(points, pool.data()) && before(points, pool.data() + pool.size()) )
+            {
+                // growing would move the source, so make room first and copy by index
+                size_t source = points - pool.data();
+                if( pool.size() + n > pool.capacity() )
+                    pool.reserve(std::max(pool.capacity() * 2, pool.size() + n));
+                for( unsigned i = 0; i < n; i++ )
+                    pool.push_back(pool[source + i]);
+            }
+            else
+                pool.insert(pool.end(), points, points + n);
+            return offset;
+        }
+
+        std::vector<v2> pool;
+        std::vector<Polygon_handle> handles;
+        size_t garbage = 0;
+    };
+}
+
+#endif
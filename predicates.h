@@ -0,0 +1,182 @@
+//
+//  predicates.h
+//  Naive2D
+//
+//  Robust orientation predicate.
+//  orient2d is evaluated in plain doubles first; only when the result is
+//  within the rounding error bound of zero is it recomputed exactly with
+//  floating point expansions. Nearly every call takes the fast path, and
+//  the sign is always right, so touching and collinear configurations get
+//  consistent answers.
+//
+//  Reference:
+//      J. R. Shewchuk, Adaptive Precision Floating-Point Arithmetic and Fast
+//      Robust Geometric Predicates, 1997.
+//      http://www.cs.cmu.edu/~quake/robust.html
+//
+
+#ifndef Naive2D_predicates_h
+#define Naive2D_predicates_h
+
+#include <algorithm>
+#include <cmath>
+
+// Keeps the rarely taken exact fallbacks out of line, so the filtered fast paths stay small enough to inline.
+#if defined(__GNUC__)
+#define N2D_COLD __attribute__((noinline, cold))
+#else
+#define N2D_COLD
+#endif
+
+namespace N2D {
+    namespace predicates
+    {
+        // 2^-53, half an ulp of 1.0
+        static constexpr double EPSILON = 1.1102230246251565e-16;
+        // relative error bound of the floating point orient2d
+        static constexpr double CCW_ERROR_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+
+        // a + b = x + y exactly
+        static inline void two_sum( double a, double b, double& x, double& y )
+        {
+            x = a + b;
+            double bv = x - a;
+            double av = x - bv;
+            y = (a - av) + (b - bv);
+        }
+
+        // a * b = x + y exactly
+        static inline void two_product( double a, double b, double& x, double& y )
+        {
+            x = a * b;
+            y = std::fma(a, b, -x);
+        }
+
+        // Adds b to a nonoverlapping expansion e[0..n) (smallest first), dropping zeros.
+        // h needs room for n + 1 components. Returns the new length.
+        static inline int grow_expansion( const double* e, int n, double b, double* h )
+        {
+            double q = b;
+            int length = 0;
+            for( int i = 0; i < n; i++ )
+            {
+                double sum, err;
+                two_sum(q, e[i], sum, err);
+                q = sum;
+                if( err != 0.0 ) h[length++] = err;
+            }
+            if( q != 0.0 || length == 0 ) h[length++] = q;
+            return length;
+        }
+
+        // Exact orient2d. Its sign is the sign of the largest component of the expansion.
+        N2D_COLD static double orient2d_exact( double ax, double ay, double bx, double by, double cx, double cy )
+        {
+            // (ax-cx)(by-cy) - (ay-cy)(bx-cx) expanded; the cx*cy terms cancel
+            double terms[12];
+            two_product( ax, by, terms[0], terms[1]);
+            two_product(-ax, cy, terms[2], terms[3]);
+            two_product(-cx, by, terms[4], terms[5]);
+            two_product(-ay, bx, terms[6], terms[7]);
+            two_product( ay, cx, terms[8], terms[9]);
+            two_product( cy, bx, terms[10], terms[11]);
+
+            double buffer[2][13];
+            int current = 0, length = 0;
+            for( double term : terms )
+            {
+                length = grow_expansion(buffer[current], length, term, buffer[1 - current]);
+                current = 1 - current;
+            }
+            return buffer[current][length - 1];
+        }
+
+        /* Positive if a, b, c are in counterclockwise order, negative if clockwise,
+         * zero if collinear. The magnitude is only an approximation of twice the
+         * triangle area, but the sign is exact.
+         */
+        static inline double orient2d( double ax, double ay, double bx, double by, double cx, double cy )
+        {
+            double detleft  = (ax - cx) * (by - cy);
+            double detright = (ay - cy) * (bx - cx);
+            double det = detleft - detright;
+            double detsum;
+
+            if( detleft > 0.0 )
+            {
+                if( detright <= 0.0 ) return det;
+                detsum = detleft + detright;
+            }
+            else if( detleft < 0.0 )
+            {
+                if( detright >= 0.0 ) return det;
+                detsum = -detleft - detright;
+            }
+            else
+                return det;
+
+            double errbound = CCW_ERROR_BOUND * detsum;
+            if( det >= errbound || -det >= errbound )
+                return det;
+            return orient2d_exact(ax, ay, bx, by, cx, cy);
+        }
+
+        static inline int sign( double value ) { return (value > 0.0) - (value < 0.0); }
+
+        // c lies in the bounding box of a-b. Together with orient2d == 0, c lies on segment a-b.
+        static inline bool in_box( double ax, double ay, double bx, double by, double cx, double cy )
+        {
+            return std::min(ax, bx) <= cx && cx <= std::max(ax, bx) && std::min(ay, by) <= cy && cy <= std::max(ay, by);
+        }
+
+        // Floating point orient2d and its error bound; the sign is certain if |det| > bound or bound == 0.
+        static inline double orient2d_fast( double ax, double ay, double bx, double by, double cx, double cy, double& bound )
+        {
+            double detleft  = (ax - cx) * (by - cy);
+            double detright = (ay - cy) * (bx - cx);
+            bound = CCW_ERROR_BOUND * (std::fabs(detleft) + std::fabs(detright));
+            return detleft - detright;
+        }
+
+        static inline bool certain( double det, double bound ) { return std::fabs(det) > bound || bound == 0.0; }
+
+        // segments_intersect when a filtered sign was uncertain: every sign exactly, zeros included.
+        N2D_COLD static bool segments_intersect_exact( double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy )
+        {
+            double o1 = orient2d(ax, ay, bx, by, cx, cy);
+            double o2 = orient2d(ax, ay, bx, by, dx, dy);
+            double o3 = orient2d(cx, cy, dx, dy, ax, ay);
+            double o4 = orient2d(cx, cy, dx, dy, bx, by);
+            return sign(o1) * sign(o2) <= 0 && sign(o3) * sign(o4) <= 0;
+        }
+
+        /* Exact test whether the closed segments a-b and c-d share a point.
+         * Touching at an endpoint and collinear overlap count as intersecting.
+         */
+        static inline bool segments_intersect( double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy )
+        {
+            // Disjoint bounding boxes. This also settles the collinear case in the exact path:
+            // collinear segments with overlapping boxes overlap.
+            // The largest gap between the boxes along either axis is positive exactly when they are
+            // disjoint (q - p > 0 iff q > p for doubles), and one compare on it is a single, well
+            // predicted branch; four compares or-ed together are split into several by the compiler.
+            double gap = std::max(std::max(std::min(cx, dx) - std::max(ax, bx), std::min(ax, bx) - std::max(cx, dx)),
+                                  std::max(std::min(cy, dy) - std::max(ay, by), std::min(ay, by) - std::max(cy, dy)));
+            if( gap > 0.0 )
+                return false;
+
+            double b1, b2, b3, b4;
+            double o1 = orient2d_fast(ax, ay, bx, by, cx, cy, b1);
+            double o2 = orient2d_fast(ax, ay, bx, by, dx, dy, b2);
+            double o3 = orient2d_fast(cx, cy, dx, dy, ax, ay, b3);
+            double o4 = orient2d_fast(cx, cy, dx, dy, bx, by, b4);
+            // one check for all four: every sign is certain and nonzero, so comparing them is enough
+            bool certain_all = (std::fabs(o1) > b1) & (std::fabs(o2) > b2) & (std::fabs(o3) > b3) & (std::fabs(o4) > b4);
+            if( certain_all )
+                return ((o1 > 0.0) != (o2 > 0.0)) & ((o3 > 0.0) != (o4 > 0.0));
+            return segments_intersect_exact(ax, ay, bx, by, cx, cy, dx, dy);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,482 @@
+//
+//  raycast.h
+//  Naive2D
+//
+//  First hit queries: a ray (a point moving along a translation) or a convex
+//  shape swept along a translation, against convex polygons and spheres.
+//  A ray is clipped against the half-planes of a convex polygon
+//  (Cyrus-Beck) and solved in closed form for an L2 sphere. A shape is
+//  moved by conservative advancement: GJK gives the closest points, and the
+//  shape can safely move until it reaches the plane through them; at a
+//  face contact that takes a single step.
+//  Ray_caster puts the obstacles of a scene in a bounding volume hierarchy
+//  and casts batches of rays (e.g. lidar beams) in parallel.
+//
+//  Reference:
+//      G. van den Bergen, Ray Casting against General Convex Objects with
+//      Application to Continuous Collision Detection, 2004.
+//
+
+#ifndef Naive2D_raycast_h
+#define Naive2D_raycast_h
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+#include "GJK_utility.h"
+
+namespace N2D {
+
+    struct Ray_hit
+    {
+        bool hit = false;
+        double fraction = 1.0;      // of the translation at the first contact
+        v2 point;                   // the first contact point
+        v2 normal;                  // unit normal of the obstacle at the point, zero if the cast starts inside it
+        uint32_t index = 0;         // the obstacle hit, for scene queries
+    };
+
+    struct Ray
+    {
+        v2 origin;
+        v2 translation;             // the ray ends at origin + translation
+    };
+
+    namespace cast_detail
+    {
+        // conservative advancement stops when the shapes are this close, relative to the translation
+        constexpr double TOLERANCE = 1e-9;
+        constexpr int MAX_ITERATIONS = 32;
+
+        // +1 if the polygon is counterclockwise, -1 if clockwise
+        static inline double orientation( const Polygon_view& polygon )
+        {
+            double area = 0.0;
+            for(unsigned i = 0; i < polygon.size; i++)
+                area += polygon[i].cross(polygon[(i + 1) % polygon.size]);
+            return area > 0 ? 1.0 : -1.0;
+        }
+
+        // Cyrus-Beck: clips the ray against the half-plane of every edge.
+        static inline Ray_hit clip( const Polygon_view& convex, double orientation, const v2& origin, const v2& translation )
+        {
+            Ray_hit hit;
+            double enter = -MAX_DOUBLE, exit = MAX_DOUBLE;
+            v2 normal;
+            for(unsigned i = 0; i < convex.size; i++)
+            {
+                const v2& a = convex[i];
+                v2 edge = convex[(i + 1) % convex.size] - a;
+                v2 outward = v2(edge.y, -edge.x) * orientation;
+                double distance = outward.dot(a - origin);     // positive on the inner side
+                double speed = outward.dot(translation);
+                if( speed == 0.0 )
+                {
+                    if( distance < 0.0 ) return hit;
+                    continue;
+                }
+                double t = distance / speed;
+                if( speed < 0.0 )
+                {
+                    if( t > enter ) { enter = t; normal = outward; }
+                }
+                else
+                    exit = std::min(exit, t);
+                if( enter > exit || enter > 1.0 || exit < 0.0 ) return hit;
+            }
+            hit.hit = true;
+            if( enter < 0.0 )
+            {
+                hit.fraction = 0.0;
+                hit.point = origin;
+                return hit;
+            }
+            hit.fraction = enter;
+            hit.point = origin + translation * enter;
+            hit.normal = normal.norm();
+            return hit;
+        }
+
+        // the polygon an L1 or L-infinity sphere is
+        static inline std::array<v2, 4> corners( const sphere& s )
+        {
+            v2 c = s.center();
+            double r = s.radius();
+            if( s.metric == SPHEREMETRIC::L1 )
+                return {{c + v2(-r, 0), c + v2(0, r), c + v2(r, 0), c + v2(0, -r)}};
+            return {{c + v2(-r, -r), c + v2(-r, r), c + v2(r, r), c + v2(r, -r)}};
+        }
+
+        /* Conservative advancement of a shape along translation towards an obstacle.
+         * @param separation: double separation(t, normal, on_obstacle, on_shape), the distance between the
+         *                    obstacle and the shape moved by t * translation, 0 if they overlap; sets the unit
+         *                    normal pointing from the obstacle to the shape and the closest points
+         */
+        template <class Separation>
+        static inline Ray_hit advance( const v2& translation, const Separation& separation )
+        {
+            Ray_hit hit;
+            double tolerance = TOLERANCE * (1.0 + translation.r());
+            double t = 0.0;
+            v2 normal, on_obstacle, on_shape;
+            double distance = separation(0.0, normal, on_obstacle, on_shape);
+            if( distance <= 0.0 )
+            {
+                hit.hit = true;
+                hit.fraction = 0.0;
+                return hit;
+            }
+            for( int i = 0; i < MAX_ITERATIONS && distance > tolerance; i++ )
+            {
+                // the shape moves towards the obstacle this fast along the normal
+                double speed = -translation.dot(normal);
+                if( speed <= 0.0 ) return hit;
+                double step = distance / speed;
+                if( t + step > 1.0 ) return hit;
+                t += step;
+                v2 next_normal, next_obstacle, next_shape;
+                double next = separation(t, next_normal, next_obstacle, next_shape);
+                if( next <= 0.0 )
+                {
+                    // touching within GJK's precision: the closest point of the shape has just reached the plane
+                    on_shape = on_shape + translation * step;
+                    on_obstacle = on_shape;
+                    distance = 0.0;
+                    break;
+                }
+                distance = next;
+                normal = next_normal;
+                on_obstacle = next_obstacle;
+                on_shape = next_shape;
+            }
+            hit.hit = true;
+            hit.fraction = t;
+            hit.point = on_obstacle;
+            hit.normal = normal;
+            return hit;
+        }
+    }
+
+    // First hit of a ray with a convex polygon in either winding order.
+    static inline Ray_hit ray_cast( const Polygon_view& convex, const v2& origin, const v2& translation )
+    {
+        return cast_detail::clip(convex, cast_detail::orientation(convex), origin, translation);
+    }
+
+    static inline Ray_hit ray_cast( const Polygon& convex, const v2& origin, const v2& translation )
+    {
+        return ray_cast(convex.view(), origin, translation);
+    }
+
+    // First hit of a ray with a sphere of any metric.
+    static inline Ray_hit ray_cast( const sphere& s, const v2& origin, const v2& translation )
+    {
+        if( s.metric != SPHEREMETRIC::L2 )
+        {
+            std::array<v2, 4> corners = cast_detail::corners(s);
+            return cast_detail::clip(Polygon_view(corners.data(), 4), -1.0, origin, translation);
+        }
+        Ray_hit hit;
+        v2 f = origin - s.center();
+        double r = s.radius();
+        double a = translation.rsq(), b = f.dot(translation), c = f.rsq() - r * r;
+        if( c <= 0.0 )
+        {
+            hit.hit = true;
+            hit.fraction = 0.0;
+            hit.point = origin;
+            return hit;
+        }
+        double discriminant = b * b - a * c;
+        if( a == 0.0 || b >= 0.0 || discriminant < 0.0 )
+            return hit;
+        // the nearer root, in the form that does not cancel
+        double t = c / (-b + std::sqrt(discriminant));
+        if( t > 1.0 )
+            return hit;
+        hit.hit = true;
+        hit.fraction = t;
+        hit.point = origin + translation * t;
+        hit.normal = (hit.point - s.center()).norm();
+        return hit;
+    }
+
+    /* First contact of a convex shape translated by `translation` with a convex obstacle.
+     * The point is where they touch, the normal is the obstacle's.
+     */
+    static inline Ray_hit shape_cast( const Polygon_view& shape, const v2& translation, const Polygon_view& obstacle )
+    {
+        std::vector<v2> moved(shape.begin(), shape.end());
+        return cast_detail::advance(translation, [&](double t, v2& normal, v2& on_obstacle, v2& on_shape){
+            for(unsigned i = 0; i < shape.size; i++) moved[i] = shape[i] + translation * t;
+            double distance = GJK::closest_points(obstacle.vertices, obstacle.size, moved.data(), shape.size, on_obstacle, on_shape);
+            if( distance > 0.0 ) normal = (on_shape - on_obstacle) / distance;
+            return distance;
+        });
+    }
+
+    static inline Ray_hit shape_cast( const Polygon_view& shape, const v2& translation, const sphere& obstacle )
+    {
+        if( obstacle.metric != SPHEREMETRIC::L2 )
+        {
+            std::array<v2, 4> corners = cast_detail::corners(obstacle);
+            return shape_cast(shape, translation, Polygon_view(corners.data(), 4));
+        }
+        std::vector<v2> moved(shape.begin(), shape.end());
+        v2 c = obstacle.center();
+        double r = obstacle.radius();
+        return cast_detail::advance(translation, [&](double t, v2& normal, v2& on_obstacle, v2& on_shape){
+            for(unsigned i = 0; i < shape.size; i++) moved[i] = shape[i] + translation * t;
+            Polygon_view polygon(moved.data(), shape.size);
+            if( polygon.contains(c) ) return 0.0;
+            on_shape = polygon.closest_pt_to(c);
+            double distance = (on_shape - c).r();
+            if( distance <= r ) return 0.0;
+            normal = (on_shape - c) / distance;
+            on_obstacle = c + normal * r;
+            return distance - r;
+        });
+    }
+
+    // A sphere translated by `translation` against a convex obstacle.
+    static inline Ray_hit shape_cast( const sphere& shape, const v2& translation, const Polygon_view& obstacle )
+    {
+        if( shape.metric != SPHEREMETRIC::L2 )
+        {
+            std::array<v2, 4> corners = cast_detail::corners(shape);
+            return shape_cast(Polygon_view(corners.data(), 4), translation, obstacle);
+        }
+        double r = shape.radius();
+        return cast_detail::advance(translation, [&](double t, v2& normal, v2& on_obstacle, v2& on_shape){
+            v2 c = shape.center() + translation * t;
+            if( obstacle.contains(c) ) return 0.0;
+            on_obstacle = obstacle.closest_pt_to(c);
+            double distance = (c - on_obstacle).r();
+            if( distance <= r ) return 0.0;
+            normal = (c - on_obstacle) / distance;
+            on_shape = c - normal * r;
+            return distance - r;
+        });
+    }
+
+    /* Ray and shape casts against a fixed set of convex obstacles, through a bounding volume
+     * hierarchy over their boxes. The obstacles are referenced, not copied, and must outlive the caster.
+     */
+    class Ray_caster
+    {
+    public:
+        // obstacles per leaf
+        static constexpr unsigned LEAF_SIZE = 4;
+
+        explicit Ray_caster( const std::vector<Polygon>& obstacles ) : obstacles(obstacles)
+        {
+            size_t n = obstacles.size();
+            orientations.resize(n);
+            std::vector<Item> items(n);
+            for( size_t i = 0; i < n; i++ )
+            {
+                orientations[i] = cast_detail::orientation(obstacles[i].view());
+                items[i].box = obstacles[i].bounds();
+                items[i].center = items[i].box.center();
+                items[i].index = (uint32_t)i;
+            }
+            nodes.reserve(4 * n / LEAF_SIZE + 1);
+            nodes.emplace_back();
+            if( n > 0 ) build(items, 0, 0, (uint32_t)n);
+            order.resize(n);
+            for( size_t i = 0; i < n; i++ ) order[i] = items[i].index;
+        }
+
+        // First hit of the ray from origin to origin + translation; hit.index is the obstacle.
+        Ray_hit ray_cast( const v2& origin, const v2& translation ) const
+        {
+            Ray_hit best;
+            if( obstacles.empty() ) return best;
+            std::pair<double, uint32_t> stack[64];
+            int top = 0;
+            double enter;
+            if( !slab(nodes[0].box, origin, translation, 1.0, enter) ) return best;
+            stack[top++] = std::make_pair(enter, 0u);
+            while( top > 0 )
+            {
+                std::pair<double, uint32_t> entry = stack[--top];
+                if( best.hit && entry.first >= best.fraction ) continue;
+                const Node& node = nodes[entry.second];
+                if( node.leaf() )
+                {
+                    for( uint32_t k = node.first; k < node.first + node.count; k++ )
+                    {
+                        uint32_t i = order[k];
+                        Ray_hit hit = cast_detail::clip(obstacles[i].view(), orientations[i], origin, translation);
+                        if( hit.hit && (!best.hit || hit.fraction < best.fraction) )
+                        {
+                            best = hit;
+                            best.index = i;
+                        }
+                    }
+                    continue;
+                }
+                // the nearer child goes on top
+                double limit = best.hit ? best.fraction : 1.0, enter1, enter2;
+                bool hit1 = slab(nodes[node.first].box, origin, translation, limit, enter1);
+                bool hit2 = slab(nodes[node.first + 1].box, origin, translation, limit, enter2);
+                if( hit1 && hit2 )
+                {
+                    if( enter1 <= enter2 )
+                    {
+                        stack[top++] = std::make_pair(enter2, node.first + 1);
+                        stack[top++] = std::make_pair(enter1, node.first);
+                    }
+                    else
+                    {
+                        stack[top++] = std::make_pair(enter1, node.first);
+                        stack[top++] = std::make_pair(enter2, node.first + 1);
+                    }
+                }
+                else if( hit1 ) stack[top++] = std::make_pair(enter1, node.first);
+                else if( hit2 ) stack[top++] = std::make_pair(enter2, node.first + 1);
+            }
+            return best;
+        }
+
+        Ray_hit ray_cast( const Ray& ray ) const { return ray_cast(ray.origin, ray.translation); }
+
+        // Casts many rays in parallel; hits[i] is the first hit of rays[i].
+        void ray_cast( const Ray* rays, size_t count, Ray_hit* hits ) const
+        {
+            int n = (int)count;
+            #pragma omp parallel for schedule(dynamic, 64)
+            for( int i = 0; i < n; i++ )
+                hits[i] = ray_cast(rays[i].origin, rays[i].translation);
+        }
+
+        void ray_cast( const std::vector<Ray>& rays, std::vector<Ray_hit>& hits ) const
+        {
+            hits.resize(rays.size());
+            ray_cast(rays.data(), rays.size(), hits.data());
+        }
+
+        // First contact of a convex shape translated by `translation`; hit.index is the obstacle.
+        Ray_hit shape_cast( const Polygon_view& shape, const v2& translation ) const
+        {
+            Ray_hit best;
+            if( obstacles.empty() ) return best;
+            AABB box = shape.bounds();
+            uint32_t stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while( top > 0 )
+            {
+                const Node& node = nodes[stack[--top]];
+                // the box the shape sweeps until the best contact so far
+                AABB swept = box;
+                swept.expand(AABB(box.min + translation * best.fraction, box.max + translation * best.fraction));
+                if( !node.box.overlaps(swept) ) continue;
+                if( !node.leaf() )
+                {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                    continue;
+                }
+                for( uint32_t k = node.first; k < node.first + node.count; k++ )
+                {
+                    uint32_t i = order[k];
+                    if( !obstacles[i].bounds().overlaps(swept) ) continue;
+                    Ray_hit hit = N2D::shape_cast(shape, translation, obstacles[i].view());
+                    if( hit.hit && (!best.hit || hit.fraction < best.fraction) )
+                    {
+                        best = hit;
+                        best.index = i;
+                    }
+                }
+            }
+            return best;
+        }
+
+    private:
+        // A leaf holds order[first .. first + count); an inner node has count 0 and its children at first and first + 1.
+        struct Node
+        {
+            AABB box;
+            uint32_t first = 0, count = 0;
+            bool leaf() const { return count > 0; }
+        };
+
+        // an obstacle while the tree is built
+        struct Item
+        {
+            AABB box;
+            v2 center;
+            uint32_t index;
+        };
+
+        const std::vector<Polygon>& obstacles;
+        std::vector<double> orientations;
+        std::vector<Node> nodes;
+        std::vector<uint32_t> order;
+
+        // Splits the obstacles at the median of their box centers along the longer side.
+        void build( std::vector<Item>& items, uint32_t index, uint32_t begin, uint32_t end )
+        {
+            AABB box, centers;
+            for( uint32_t k = begin; k < end; k++ )
+            {
+                box.expand(items[k].box);
+                centers.expand(items[k].center);
+            }
+            nodes[index].box = box;
+            if( end - begin <= LEAF_SIZE )
+            {
+                nodes[index].first = begin;
+                nodes[index].count = end - begin;
+                return;
+            }
+
+            bool along_x = centers.max.x - centers.min.x >= centers.max.y - centers.min.y;
+            uint32_t middle = begin + (end - begin) / 2;
+            std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [&](const Item& a, const Item& b){
+                return along_x ? a.center.x < b.center.x : a.center.y < b.center.y;
+            });
+
+            uint32_t children = (uint32_t)nodes.size();
+            nodes[index].first = children;
+            nodes.emplace_back();
+            nodes.emplace_back();
+            build(items, children, begin, middle);
+            build(items, children + 1, middle, end);
+        }
+
+        // Whether the ray enters the box before `limit`; `enter` is where.
+        static bool slab( const AABB& box, const v2& origin, const v2& translation, double limit, double& enter )
+        {
+            double t_enter = 0.0, t_exit = limit;
+            for( int axis = 0; axis < 2; axis++ )
+            {
+                double o = axis == 0 ? origin.x : origin.y;
+                double d = axis == 0 ? translation.x : translation.y;
+                double lo = axis == 0 ? box.min.x : box.min.y;
+                double hi = axis == 0 ? box.max.x : box.max.y;
+                if( d == 0.0 )
+                {
+                    if( o < lo || o > hi ) return false;
+                    continue;
+                }
+                double t1 = (lo - o) / d, t2 = (hi - o) / d;
+                if( t1 > t2 ) std::swap(t1, t2);
+                t_enter = std::max(t_enter, t1);
+                t_exit = std::min(t_exit, t2);
+                if( t_enter > t_exit ) return false;
+            }
+            enter = t_enter;
+            return true;
+        }
+    };
+}
+
+#endif
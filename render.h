@@ -21,6 +21,7 @@
 
 #include "geometry.h"
 #include "polygon.h"
+#include "trace.h"
 #include <vector>
 
 
@@ -40,6 +41,15 @@ namespace N2D {
         static int WIDTH  = 0;
         static int HEIGHT = 0;
         
+        static void (*display_func)(void) = nullptr;
+        
+        // glut calls this once per frame, so every frame shows up as one span when tracing
+        static void display_frame()
+        {
+            N2D_TRACE_SPAN("render::frame");
+            display_func();
+        }
+        
         /* create a window
          * @param width: the width of the window
          * @param height: the height of the window
@@ -71,7 +81,8 @@ namespace N2D {
         {
             if(!window_initialized)
                 throw "Please initialize rendering then initalize window.";
-            glutDisplayFunc(func);
+            display_func = func;
+            glutDisplayFunc(display_frame);
             display_set = true;
         }
         
@@ -93,11 +104,13 @@ namespace N2D {
         
         void clean_screen()
         {
+            N2D_TRACE_SPAN("render::clean_screen");
             glClear(GL_COLOR_BUFFER_BIT);   // Clear the color buffer with current clearing color
         }
         
         void flush()
         {
+            N2D_TRACE_SPAN("render::flush");
             glFlush();
         }
         
@@ -133,6 +146,7 @@ namespace N2D {
         // Render lines that connect points[0] to points[-1]
         void lines( const std::vector<v2>& points, Color color )
         {
+            N2D_TRACE_SPAN("render::lines");
             glBegin(GL_LINES);
             glColor4f(color.R/255.0f, color.G/255.0f, color.B/255.0f, color.A/255.0f);
             for (int i = 0; i < points.size(); i++) {
@@ -144,6 +158,7 @@ namespace N2D {
         // Render lines.
         void lines( const std::vector<Line_segment>& lines, Color color )
         {
+            N2D_TRACE_SPAN("render::lines");
             for (Line_segment line : lines) {
                 line_seg(line, color);
             }
@@ -171,6 +186,7 @@ namespace N2D {
         /* Render all polygons */
         void polygons( std::vector<Polygon>& polygons, Color color = Color(100, 100, 100, 150), bool fill = true )
         {
+            N2D_TRACE_SPAN("render::polygons");
             for( int i = 0; i < polygons.size(); i++  )
             {
                 Polygon poly = polygons[i];
@@ -238,6 +254,7 @@ namespace N2D {
         /* Render all spheres */
         void spheres( std::vector<struct sphere>& spheres, Color color = Color(100, 100, 100, 150), bool fill = true )
         {
+            N2D_TRACE_SPAN("render::spheres");
             for( int i = 0; i < spheres.size(); i++  )
             {
                 struct sphere s = spheres[i];
@@ -0,0 +1,468 @@
+//
+//  scene_file.h
+//  Naive2D
+//
+//  A versioned binary scene format which can be memory mapped and queried
+//  without parsing or copying.
+//
+//  Layout (native byte order, every section 16 bytes aligned):
+//      Header
+//      v2              vertices[vertex_count]        -- one flat vertex pool
+//      Polygon_record  polygons[polygon_count]       -- (offset, count) into the pool
+//      Sphere_record   spheres[sphere_count]
+//      Bounds_record   bounds[polygon_count]         -- optional, see HAS_BOUNDS
+//
+//  Text format accepted by import_text_scene, one shape per line:
+//      # comment
+//      polygon x1 y1 x2 y2 x3 y3 ...
+//      sphere cx cy r [l1|l2|linfty]
+//
+
+#ifndef Naive2D_scene_file_h
+#define Naive2D_scene_file_h
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+// keep windows.h from defining min / max (and the rest of the kitchen sink) over std::min / std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    namespace scene_file {
+
+        static constexpr char     MAGIC[4]   = {'N', '2', 'D', 'S'};
+        static constexpr uint32_t VERSION    = 1;
+        static constexpr uint32_t ENDIAN_TAG = 0x01020304;
+
+        // flags
+        static constexpr uint32_t HAS_BOUNDS = 1;
+
+        struct Header
+        {
+            char     magic[4];
+            uint32_t version;
+            uint32_t byte_order;
+            uint32_t flags;
+            uint64_t vertex_count;
+            uint64_t polygon_count;
+            uint64_t sphere_count;
+            uint64_t vertex_offset;
+            uint64_t polygon_offset;
+            uint64_t sphere_offset;
+            uint64_t bounds_offset;
+            uint64_t reserved;
+        };
+
+        struct Polygon_record
+        {
+            uint64_t offset;    // index of the first vertex in the pool
+            uint32_t count;     // number of vertices
+            uint32_t reserved;
+        };
+
+        struct Sphere_record
+        {
+            double   cx, cy, r;
+            uint32_t metric;    // SPHEREMETRIC
+            uint32_t reserved;
+        };
+
+        struct Bounds_record
+        {
+            double min_x, min_y, max_x, max_y;
+        };
+
+        static_assert(sizeof(v2) == 2 * sizeof(double), "the vertex pool is mapped directly as v2");
+        static_assert(sizeof(Header) % 16 == 0, "sections must stay aligned");
+        static_assert(sizeof(Polygon_record) == 16 && sizeof(Sphere_record) == 32 && sizeof(Bounds_record) == 32, "records must be packed");
+
+        static inline uint64_t align16( uint64_t offset ) { return (offset + 15) & ~uint64_t(15); }
+    }
+
+    /* Writes a scene file. Vertices are streamed to disk as polygons are added,
+     * only the small per-polygon records are kept in memory until finish().
+     */
+    class Scene_writer
+    {
+    public:
+        /* @param path: file to create (truncated if exists)
+         * @param write_bounds: also store the bounding box of every polygon
+         */
+        explicit Scene_writer( const std::string& path, bool write_bounds = true ) : out(path, std::ios::binary | std::ios::trunc), with_bounds(write_bounds)
+        {
+            if( !out )
+                throw "Scene_writer: cannot open file for writing.";
+            scene_file::Header empty;
+            std::memset(&empty, 0, sizeof(empty));
+            out.write(reinterpret_cast<const char*>(&empty), sizeof(empty));
+        }
+
+        Scene_writer( const Scene_writer& ) = delete;
+        Scene_writer& operator=( const Scene_writer& ) = delete;
+
+        ~Scene_writer()
+        {
+            if( finished ) return;
+            try { finish(); } catch (...) {}
+        }
+
+        void add_polygon( const v2* points, unsigned n )
+        {
+            if( finished )
+                throw "Scene_writer: scene is already finished.";
+            if( n < 3 )
+                throw "Scene_writer: polygon needs at least 3 vertices.";
+            scene_file::Polygon_record record;
+            record.offset = vertex_count;
+            record.count = n;
+            record.reserved = 0;
+            polygons.push_back(record);
+
+            out.write(reinterpret_cast<const char*>(points), sizeof(v2) * n);
+            vertex_count += n;
+
+            if( with_bounds )
+            {
+                AABB box = Polygon_view(points, n).bounds();
+                bounds.push_back(scene_file::Bounds_record{box.min.x, box.min.y, box.max.x, box.max.y});
+            }
+        }
+
+        void add_polygon( const Polygon_view& polygon ) { add_polygon(polygon.vertices, polygon.size); }
+
+        void add_polygon( const Polygon& polygon ) { add_polygon(polygon.view()); }
+
+        void add_sphere( const sphere& s )
+        {
+            if( finished )
+                throw "Scene_writer: scene is already finished.";
+            spheres.push_back(scene_file::Sphere_record{s.c_.x, s.c_.y, s.r_, (uint32_t)s.metric, 0});
+        }
+
+        // Writes the record sections and the header. No shape can be added afterwards.
+        void finish()
+        {
+            if( finished ) return;
+            finished = true;
+
+            scene_file::Header header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, scene_file::MAGIC, sizeof(header.magic));
+            header.version       = scene_file::VERSION;
+            header.byte_order    = scene_file::ENDIAN_TAG;
+            header.flags         = with_bounds ? scene_file::HAS_BOUNDS : 0;
+            header.vertex_count  = vertex_count;
+            header.polygon_count = polygons.size();
+            header.sphere_count  = spheres.size();
+            header.vertex_offset = sizeof(scene_file::Header);
+
+            uint64_t pos = header.vertex_offset + vertex_count * sizeof(v2);
+            header.polygon_offset = pad_to(pos);
+            write_section(polygons, pos);
+            header.sphere_offset = pad_to(pos);
+            write_section(spheres, pos);
+            if( with_bounds )
+            {
+                header.bounds_offset = pad_to(pos);
+                write_section(bounds, pos);
+            }
+
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.flush();
+            if( !out )
+                throw "Scene_writer: failed writing scene file.";
+            out.close();
+        }
+
+    private:
+        std::ofstream out;
+        bool with_bounds;
+        bool finished = false;
+        uint64_t vertex_count = 0;
+        std::vector<scene_file::Polygon_record> polygons;
+        std::vector<scene_file::Sphere_record> spheres;
+        std::vector<scene_file::Bounds_record> bounds;
+
+        uint64_t pad_to( uint64_t& pos )
+        {
+            static const char zeros[16] = {0};
+            uint64_t aligned = scene_file::align16(pos);
+            out.write(zeros, (std::streamsize)(aligned - pos));
+            pos = aligned;
+            return pos;
+        }
+
+        template <class Record>
+        void write_section( const std::vector<Record>& records, uint64_t& pos )
+        {
+            out.write(reinterpret_cast<const char*>(records.data()), (std::streamsize)(sizeof(Record) * records.size()));
+            pos += sizeof(Record) * records.size();
+        }
+    };
+
+    /* A read only, memory mapped scene file. Polygons are handed out as views
+     * into the mapping, so opening even a very large scene costs only the mmap.
+     * The views are valid as long as the Scene_file is alive.
+     */
+    class Scene_file
+    {
+    public:
+        explicit Scene_file( const std::string& path )
+        {
+            map(path);
+            try { validate(); }
+            catch (...) { unmap(); throw; }
+        }
+
+        Scene_file( const Scene_file& ) = delete;
+        Scene_file& operator=( const Scene_file& ) = delete;
+
+        ~Scene_file() { unmap(); }
+
+        uint64_t vertex_count()  const { return header->vertex_count; }
+        uint64_t polygon_count() const { return header->polygon_count; }
+        uint64_t sphere_count()  const { return header->sphere_count; }
+
+        // the flat vertex pool shared by all polygons
+        const v2* vertices() const { return reinterpret_cast<const v2*>(data + header->vertex_offset); }
+
+        // the i-th polygon, without copying its vertices
+        Polygon_view polygon( uint64_t i ) const
+        {
+            assert(i < polygon_count());
+            const scene_file::Polygon_record& record = polygon_records()[i];
+            assert(record.offset + record.count <= vertex_count());
+            return Polygon_view(vertices() + record.offset, record.count);
+        }
+
+        sphere get_sphere( uint64_t i ) const
+        {
+            assert(i < sphere_count());
+            const scene_file::Sphere_record& record = sphere_records()[i];
+            return sphere(v2(record.cx, record.cy), record.r, (SPHEREMETRIC)record.metric);
+        }
+
+        bool has_bounds() const { return header->flags & scene_file::HAS_BOUNDS; }
+
+        // bounding box of the i-th polygon. Computed on the fly if the file does not store bounds.
+        AABB bounds( uint64_t i ) const
+        {
+            if( !has_bounds() )
+                return polygon(i).bounds();
+            const scene_file::Bounds_record& record = reinterpret_cast<const scene_file::Bounds_record*>(data + header->bounds_offset)[i];
+            return AABB(v2(record.min_x, record.min_y), v2(record.max_x, record.max_y));
+        }
+
+        // Copies every polygon into an owning Polygon. Only needed by code that mutates them.
+        std::vector<Polygon> load_polygons() const
+        {
+            std::vector<Polygon> result;
+            result.reserve(polygon_count());
+            for( uint64_t i = 0; i < polygon_count(); i++ )
+                result.emplace_back(polygon(i));
+            return result;
+        }
+
+    private:
+        const char* data = nullptr;
+        uint64_t length = 0;
+        const scene_file::Header* header = nullptr;
+#if defined(_WIN32)
+        HANDLE file_handle = INVALID_HANDLE_VALUE;
+        HANDLE mapping_handle = NULL;
+#endif
+
+        const scene_file::Polygon_record* polygon_records() const { return reinterpret_cast<const scene_file::Polygon_record*>(data + header->polygon_offset); }
+        const scene_file::Sphere_record* sphere_records() const { return reinterpret_cast<const scene_file::Sphere_record*>(data + header->sphere_offset); }
+
+        bool section_fits( uint64_t offset, uint64_t count, uint64_t record_size ) const
+        {
+            if( offset % 16 != 0 || offset > length ) return false;
+            return count <= (length - offset) / record_size;
+        }
+
+        void validate()
+        {
+            if( length < sizeof(scene_file::Header) )
+                throw "Scene_file: file is too small to be a scene.";
+            header = reinterpret_cast<const scene_file::Header*>(data);
+            if( std::memcmp(header->magic, scene_file::MAGIC, sizeof(header->magic)) != 0 )
+                throw "Scene_file: not a scene file.";
+            if( header->byte_order != scene_file::ENDIAN_TAG )
+                throw "Scene_file: scene was written on a machine with another byte order.";
+            if( header->version != scene_file::VERSION )
+                throw "Scene_file: unsupported scene file version.";
+            if( !section_fits(header->vertex_offset, header->vertex_count, sizeof(v2)) ||
+                !section_fits(header->polygon_offset, header->polygon_count, sizeof(scene_file::Polygon_record)) ||
+                !section_fits(header->sphere_offset, header->sphere_count, sizeof(scene_file::Sphere_record)) ||
+                ( (header->flags & scene_file::HAS_BOUNDS) && !section_fits(header->bounds_offset, header->polygon_count, sizeof(scene_file::Bounds_record)) ) )
+                throw "Scene_file: scene file is truncated or corrupted.";
+
+            // every record is checked once here, so the accessors can index without checks
+            const scene_file::Polygon_record* records = polygon_records();
+            for( uint64_t i = 0; i < header->polygon_count; i++ )
+            {
+                if( records[i].count < 3 )
+                    throw "Scene_file: polygon has less than 3 vertices.";
+                if( records[i].offset > header->vertex_count || records[i].count > header->vertex_count - records[i].offset )
+                    throw "Scene_file: polygon refers to vertices outside the pool.";
+            }
+            const scene_file::Sphere_record* spheres = sphere_records();
+            for( uint64_t i = 0; i < header->sphere_count; i++ )
+                if( spheres[i].metric > (uint32_t)SPHEREMETRIC::LINFTY )
+                    throw "Scene_file: sphere has an unknown metric.";
+        }
+
+#if defined(_WIN32)
+        void map( const std::string& path )
+        {
+            file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if( file_handle == INVALID_HANDLE_VALUE )
+                throw "Scene_file: cannot open file.";
+            LARGE_INTEGER size;
+            if( !GetFileSizeEx(file_handle, &size) || size.QuadPart == 0 )
+            {
+                unmap();
+                throw "Scene_file: cannot read file size.";
+            }
+            length = (uint64_t)size.QuadPart;
+            mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if( mapping_handle != NULL )
+                data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+            if( data == nullptr )
+            {
+                unmap();
+                throw "Scene_file: cannot map file.";
+            }
+        }
+
+        void unmap()
+        {
+            if( data ) UnmapViewOfFile(data);
+            if( mapping_handle != NULL ) CloseHandle(mapping_handle);
+            if( file_handle != INVALID_HANDLE_VALUE ) CloseHandle(file_handle);
+            data = nullptr; mapping_handle = NULL; file_handle = INVALID_HANDLE_VALUE;
+        }
+#else
+        void map( const std::string& path )
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if( fd < 0 )
+                throw "Scene_file: cannot open file.";
+            struct stat st;
+            if( fstat(fd, &st) != 0 || st.st_size == 0 )
+            {
+                ::close(fd);
+                throw "Scene_file: cannot read file size.";
+            }
+            length = (uint64_t)st.st_size;
+            void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if( addr == MAP_FAILED )
+                throw "Scene_file: cannot map file.";
+            data = static_cast<const char*>(addr);
+        }
+
+        void unmap()
+        {
+            if( data ) munmap(const_cast<char*>(data), length);
+            data = nullptr;
+        }
+#endif
+    };
+
+    /* Writes every polygon and sphere into a scene file.
+     */
+    static inline void write_scene( const std::string& path, const std::vector<Polygon>& polygons, const std::vector<sphere>& spheres = std::vector<sphere>(), bool with_bounds = true )
+    {
+        Scene_writer writer(path, with_bounds);
+        for( const Polygon& polygon : polygons )
+            writer.add_polygon(polygon);
+        for( const sphere& s : spheres )
+            writer.add_sphere(s);
+        writer.finish();
+    }
+
+    /* Streams a text scene (see the top of this file) into a writer, one line at
+     * a time, so the text never has to fit into memory.
+     */
+    static inline void import_text_scene( std::istream& in, Scene_writer& writer )
+    {
+        std::string line;
+        std::vector<v2> points;
+        while( std::getline(in, line) )
+        {
+            const char* cursor = line.c_str();
+            while( *cursor == ' ' || *cursor == '\t' ) cursor++;
+            if( *cursor == '\0' || *cursor == '#' || *cursor == '\r' )
+                continue;
+
+            char* next = nullptr;
+            if( std::strncmp(cursor, "polygon", 7) == 0 )
+            {
+                cursor += 7;
+                points.clear();
+                while( true )
+                {
+                    double x = std::strtod(cursor, &next);
+                    if( next == cursor ) break;
+                    cursor = next;
+                    double y = std::strtod(cursor, &next);
+                    if( next == cursor )
+                        throw "import_text_scene: polygon has an odd number of coordinates.";
+                    cursor = next;
+                    points.push_back(v2(x, y));
+                }
+                if( points.size() < 3 )
+                    throw "import_text_scene: polygon needs at least 3 vertices.";
+                writer.add_polygon(points.data(), (unsigned)points.size());
+            }
+            else if( std::strncmp(cursor, "sphere", 6) == 0 )
+            {
+                cursor += 6;
+                double values[3];
+                for( double& value : values )
+                {
+                    value = std::strtod(cursor, &next);
+                    if( next == cursor )
+                        throw "import_text_scene: sphere needs a center and a radius.";
+                    cursor = next;
+                }
+                while( *cursor == ' ' || *cursor == '\t' ) cursor++;
+                SPHEREMETRIC metric = SPHEREMETRIC::L2;
+                if( std::strncmp(cursor, "l1", 2) == 0 ) metric = SPHEREMETRIC::L1;
+                else if( std::strncmp(cursor, "linfty", 6) == 0 ) metric = SPHEREMETRIC::LINFTY;
+                else if( *cursor != '\0' && *cursor != '\r' && std::strncmp(cursor, "l2", 2) != 0 )
+                    throw "import_text_scene: metric has to be l1, l2 or linfty.";
+                writer.add_sphere(sphere(v2(values[0], values[1]), values[2], metric));
+            }
+            else
+                throw "import_text_scene: unknown shape, expected polygon or sphere.";
+        }
+    }
+}
+
+#endif
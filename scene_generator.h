@@ -0,0 +1,156 @@
+//
+//  scene_generator.h
+//  Naive2D
+//
+//  Seeded random shapes and scenes: convex polygons, star shaped
+//  (non-convex but simple) polygons, spheres, segments and whole obstacle
+//  fields of a given density. The same seed always gives the same shapes,
+//  so a failing case can be reproduced from its seed alone. It is used by the
+//  differential harness and as a load generator for scaling tests.
+//
+
+#ifndef Naive2D_scene_generator_h
+#define Naive2D_scene_generator_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    struct Scene_parameters
+    {
+        AABB region = AABB(v2(0, 0), v2(1000, 1000));
+        double density = 0.2;               // expected fraction of the region the obstacles cover, overlaps counted twice
+        double min_radius = 5.0, max_radius = 20.0;
+        unsigned min_vertices = 3, max_vertices = 12;
+        double convex_fraction = 1.0;       // the others are star shaped
+    };
+
+    class Scene_generator
+    {
+    public:
+        explicit Scene_generator( uint64_t seed ) : rng(seed) {}
+
+        // The seed of case i of a run; scrambled so that neighbouring cases are unrelated.
+        static uint64_t case_seed( uint64_t seed, uint64_t i )
+        {
+            // splitmix64
+            uint64_t z = seed + (i + 1) * 0x9e3779b97f4a7c15ull;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        double uniform( double min, double max ) { return std::uniform_real_distribution<double>(min, max)(rng); }
+
+        unsigned integer( unsigned min, unsigned max ) { return std::uniform_int_distribution<unsigned>(min, max)(rng); }
+
+        bool chance( double p ) { return uniform(0.0, 1.0) < p; }
+
+        v2 random_point( const AABB& region ) { return v2(uniform(region.min.x, region.max.x), uniform(region.min.y, region.max.y)); }
+
+        /* A convex polygon, clockwise: points of an ellipse with the given largest radius, randomly
+         * stretched and rotated.
+         */
+        Polygon random_convex( const v2& center, double radius, unsigned vertices )
+        {
+            std::vector<double> angles = sorted_angles(vertices);
+            double stretch = uniform(0.3, 1.0), rotation = uniform(0.0, 2 * PI);
+            std::vector<v2> points;
+            points.reserve(vertices);
+            for( double angle : angles )
+            {
+                v2 p(radius * std::cos(angle), radius * stretch * std::sin(angle));
+                points.push_back(center + v2(p.x * std::cos(rotation) - p.y * std::sin(rotation), p.x * std::sin(rotation) + p.y * std::cos(rotation)));
+            }
+            return Polygon(std::move(points));
+        }
+
+        /* A simple polygon that is star shaped around center, clockwise. Usually not convex.
+         * @param spikiness: 0 gives points on a circle, 1 lets vertices come arbitrarily close to the center
+         */
+        Polygon random_star( const v2& center, double radius, unsigned vertices, double spikiness = 0.7 )
+        {
+            std::vector<double> angles = sorted_angles(vertices);
+            std::vector<v2> points;
+            points.reserve(vertices);
+            for( double angle : angles )
+            {
+                double r = radius * uniform(1.0 - spikiness, 1.0);
+                points.push_back(center + v2(r * std::cos(angle), r * std::sin(angle)));
+            }
+            return Polygon(std::move(points));
+        }
+
+        // A sphere with a random metric
+        sphere random_sphere( const v2& center, double radius )
+        {
+            static const SPHEREMETRIC metrics[] = {SPHEREMETRIC::L1, SPHEREMETRIC::L2, SPHEREMETRIC::LINFTY};
+            return sphere(center, radius, metrics[integer(0, 2)]);
+        }
+
+        // A segment starting in region, of length up to max_length
+        Line_segment random_segment( const AABB& region, double max_length )
+        {
+            v2 start = random_point(region);
+            double angle = uniform(0.0, 2 * PI), length = uniform(0.0, max_length);
+            return Line_segment(start, start + v2(length * std::cos(angle), length * std::sin(angle)));
+        }
+
+        // Obstacles spread uniformly over the region; they may overlap.
+        std::vector<Polygon> random_scene( const Scene_parameters& parameters )
+        {
+            v2 size = parameters.region.max - parameters.region.min;
+            // average area of a polygon inscribed in a circle of a uniformly distributed radius
+            double r1 = parameters.min_radius, r2 = parameters.max_radius;
+            double mean_square_radius = (r1 * r1 + r1 * r2 + r2 * r2) / 3.0;
+            double count = parameters.density * size.x * size.y / (0.7 * PI * mean_square_radius);
+
+            std::vector<Polygon> obstacles;
+            obstacles.reserve((size_t)count);
+            for( size_t i = 0; i < (size_t)count; i++ )
+            {
+                v2 center = random_point(parameters.region);
+                double radius = uniform(r1, r2);
+                unsigned vertices = integer(parameters.min_vertices, parameters.max_vertices);
+                if( chance(parameters.convex_fraction) )
+                    obstacles.push_back(random_convex(center, radius, vertices));
+                else
+                    obstacles.push_back(random_star(center, radius, vertices));
+            }
+            return obstacles;
+        }
+
+    private:
+        std::mt19937_64 rng;
+
+        /* n distinct angles in decreasing order (clockwise) without a gap of half a turn or more, so
+         * that points at these angles around a center form a simple polygon star shaped around it.
+         */
+        std::vector<double> sorted_angles( unsigned n )
+        {
+            if( n < 3 )
+                throw "A polygon needs at least 3 vertices.";
+            std::vector<double> angles(n);
+            while( true )
+            {
+                for( double& angle : angles ) angle = uniform(0.0, 2 * PI);
+                std::sort(angles.begin(), angles.end(), std::greater<double>());
+                double widest = 2 * PI - (angles.front() - angles.back());
+                for( unsigned i = 1; i < n; i++ )
+                    widest = std::max(widest, angles[i - 1] - angles[i]);
+                if( std::adjacent_find(angles.begin(), angles.end()) == angles.end() && widest < PI )
+                    break;
+            }
+            return angles;
+        }
+    };
+}
+
+#endif
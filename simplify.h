@@ -0,0 +1,212 @@
+//
+//  simplify.h
+//  Naive2D
+//
+//  Conservative polygon simplification for level of detail queries.
+//  A dense outline is replaced by its convex hull, which is then reduced by
+//  collapsing edges outward: an edge b-c is removed by extending its two
+//  neighbouring edges until they meet. The result always contains the
+//  original polygon, so a miss on the coarse shape is a miss on the real one.
+//
+
+#ifndef Naive2D_simplify_h
+#define Naive2D_simplify_h
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    /* Convex hull of the vertices of a polygon (Andrew's monotone chain).
+     * Returned in clockwise order, without collinear points.
+     */
+    static inline std::vector<v2> convex_hull( const Polygon_view& polygon )
+    {
+        std::vector<v2> points(polygon.begin(), polygon.end());
+        std::sort(points.begin(), points.end(), [](const v2& a, const v2& b){ return a.x < b.x || (a.x == b.x && a.y < b.y); });
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+        if( points.size() < 3 )
+            return points;
+
+        std::vector<v2> hull(2 * points.size());
+        size_t k = 0;
+        // lower hull then upper hull, keeping clockwise turns only
+        for( size_t i = 0; i < points.size(); i++ )
+        {
+            while( k >= 2 && (hull[k-1] - hull[k-2]).cross(points[i] - hull[k-2]) >= 0 ) k--;
+            hull[k++] = points[i];
+        }
+        for( size_t i = points.size() - 1, t = k + 1; i-- > 0; )
+        {
+            while( k >= t && (hull[k-1] - hull[k-2]).cross(points[i] - hull[k-2]) >= 0 ) k--;
+            hull[k++] = points[i];
+        }
+        hull.resize(k - 1);
+        return hull;
+    }
+
+    /* Reduces a convex polygon by collapsing edges outward while the result stays within
+     * tolerance of the input.
+     * @param convex: a convex polygon, clockwise or counterclockwise
+     * @param tolerance: how far (distance) the new boundary may move away from the input
+     * @param min_vertices: stop before going below this many vertices (at least 3)
+     * The result contains the input.
+     */
+    static inline std::vector<v2> simplify_outward( const std::vector<v2>& convex, double tolerance, unsigned min_vertices = 3 )
+    {
+        size_t n = convex.size();
+        min_vertices = std::max(min_vertices, 3u);
+        if( n <= min_vertices )
+            return convex;
+
+        // orientation: +1 counterclockwise, -1 clockwise
+        double area = 0.0;
+        for( size_t i = 0; i < n; i++ )
+            area += convex[i].cross(convex[(i + 1) % n]);
+        double orientation = area > 0 ? 1.0 : -1.0;
+
+        std::vector<v2> points(convex);
+        std::vector<size_t> prev(n), next(n);
+        std::vector<unsigned> stamp(n, 0);
+        std::vector<bool> removed(n, false);
+        // vertex i stands for the input vertices first[i] .. last[i] (cyclic); it lies on the lines of
+        // the input edges entering first[i] and leaving last[i]
+        std::vector<size_t> first(n), last(n);
+        for( size_t i = 0; i < n; i++ )
+        {
+            prev[i] = (i + n - 1) % n;
+            next[i] = (i + 1) % n;
+            first[i] = last[i] = i;
+        }
+
+        // Collapsing edge (b, c) moves b and c to the point where the lines a->b and d->c meet.
+        // Its cost is how far that point is from the input, measured against the input edges it
+        // replaces, so the errors of successive collapses do not add up. Since the result is convex
+        // and contains the input, it is then within tolerance of the input everywhere.
+        struct Candidate { double cost; size_t b; unsigned stamp; v2 apex; };
+        auto cmp = [](const Candidate& x, const Candidate& y){ return x.cost > y.cost; };
+        std::priority_queue<Candidate, std::vector<Candidate>, decltype(cmp)> queue(cmp);
+
+        auto evaluate = [&]( size_t b )
+        {
+            size_t c = next[b], a = prev[b], d = next[c];
+            v2 ab = points[b] - points[a];
+            v2 dc = points[c] - points[d];
+            v2 bc = points[c] - points[b];
+            double denom = ab.cross(dc);
+            // the neighbouring edges have to converge beyond the edge, i.e. turn by less than 180 degrees in total
+            if( denom * orientation >= 0.0 ) return;
+            double t = (points[d] - points[a]).cross(dc) / denom;
+            v2 apex = points[a] + ab * t;
+            double len = bc.r();
+            if( len == 0.0 ) return;
+            // the distance to the line b-c is a lower bound, as the input lies behind that line
+            if( std::fabs(bc.cross(apex - points[b])) / len > tolerance ) return;
+            double cost = MAX_DOUBLE;
+            for( size_t k = (first[b] + n - 1) % n; ; k = (k + 1) % n )
+            {
+                cost = std::min(cost, Line_segment(convex[k], convex[(k + 1) % n]).dist_to(apex));
+                if( k == last[c] ) break;
+            }
+            if( cost <= tolerance )
+                queue.push(Candidate{cost, b, stamp[b], apex});
+        };
+
+        for( size_t i = 0; i < n; i++ )
+            evaluate(i);
+
+        size_t remaining = n;
+        while( remaining > min_vertices && !queue.empty() )
+        {
+            Candidate top = queue.top(); queue.pop();
+            size_t b = top.b;
+            if( removed[b] || top.stamp != stamp[b] ) continue;
+            size_t c = next[b];
+            // b takes the apex, c disappears
+            points[b] = top.apex;
+            last[b] = last[c];
+            removed[c] = true;
+            next[b] = next[c];
+            prev[next[c]] = b;
+            remaining--;
+            // every edge whose neighbourhood changed has to be re-evaluated
+            for( size_t e : {prev[prev[b]], prev[b], b, next[b]} )
+            {
+                stamp[e]++;
+                evaluate(e);
+            }
+        }
+
+        std::vector<v2> result;
+        result.reserve(remaining);
+        size_t start = 0;
+        while( removed[start] ) start++;
+        size_t i = start;
+        do {
+            result.push_back(points[i]);
+            i = next[i];
+        } while( i != start );
+        return result;
+    }
+
+    /* A polygon with a chain of coarser convex shapes which contain it.
+     * Queries try the coarsest shape first and only refine when it cannot decide.
+     */
+    struct LOD_polygon
+    {
+        Polygon full;
+        std::vector<Polygon> levels;    // coarsest first
+        bool convex;                    // if full is convex, GJK is used on it
+
+        /* @param polygon: the original polygon
+         * @param tolerances: one simplification tolerance per level, e.g. {8, 2, 0.5}
+         * @param convex: whether the original polygon is convex
+         */
+        LOD_polygon( const Polygon& polygon, const std::vector<double>& tolerances, bool convex = false ) : full(polygon), convex(convex)
+        {
+            std::vector<v2> hull = convex_hull(polygon.view());
+            std::vector<double> sorted(tolerances);
+            std::sort(sorted.begin(), sorted.end(), std::greater<double>());
+            for( double tolerance : sorted )
+                levels.emplace_back(simplify_outward(hull, tolerance));
+            // the hull itself is the finest convex level, unless it is the shape itself
+            if( !convex && hull.size() >= 3 )
+                levels.emplace_back(std::move(hull));
+        }
+
+        size_t vertex_count( size_t level ) const { return levels[level].vertices.size(); }
+
+        bool contains( const v2& point ) const
+        {
+            for( const Polygon& level : levels )
+                if( !level.contains(point) ) return false;
+            return full.contains(point);
+        }
+
+        // Exact intersection with a convex polygon.
+        bool intersects( const Polygon_view& other ) const
+        {
+            for( const Polygon& level : levels )
+                if( !level.view().intersects(other) ) return false;
+            return convex ? full.view().intersects(other) : full.view().naive_intersects(other);
+        }
+
+        bool intersects( const Polygon& other ) const { return intersects(other.view()); }
+
+        // Exact test of distance_to(other) <= threshold with a convex polygon.
+        bool within_distance( const Polygon_view& other, double threshold ) const
+        {
+            for( const Polygon& level : levels )
+                if( level.view().distance_to(other) > threshold ) return false;
+            return (convex ? full.view().distance_to(other) : full.view().naive_distance_to(other)) <= threshold;
+        }
+
+        bool within_distance( const Polygon& other, double threshold ) const { return within_distance(other.view(), threshold); }
+    };
+}
+
+#endif
@@ -0,0 +1,267 @@
+//
+//  sweep_prune.h
+//  Naive2D
+//
+//  Incremental sweep and prune broad-phase.
+//  The min/max endpoints of every bounding box are kept sorted on x and on y.
+//  When a box moves a little, its endpoints are moved with insertion sort, and
+//  every time a min endpoint crosses a max endpoint the pair of boxes is
+//  re-tested. Pairs which start or stop overlapping are reported as events, so
+//  the narrow-phase (GJK) only has to look at new or persisting pairs.
+//
+//  Reference:
+//      D. Baraff, Dynamic simulation of non-penetrating rigid bodies, 1992.
+//
+
+#ifndef Naive2D_sweep_prune_h
+#define Naive2D_sweep_prune_h
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    class Sweep_and_prune
+    {
+    public:
+        typedef uint32_t id_type;
+
+        // Two overlapping boxes, a < b.
+        struct Pair
+        {
+            id_type a, b;
+            bool operator==( const Pair& other ) const { return a == other.a && b == other.b; }
+        };
+
+        Sweep_and_prune() = default;
+
+        // Adds a box and returns its id. Pairs it overlaps are reported as added.
+        id_type add( const AABB& box )
+        {
+            id_type id = (id_type)boxes.size();
+            Box entry;
+            entry.box = AABB(INFINITE_POINT, INFINITE_POINT);
+            entry.alive = true;
+            for( int axis = 0; axis < 2; axis++ )
+            {
+                entry.min_at[axis] = (uint32_t)endpoints[axis].size();
+                endpoints[axis].push_back(Endpoint{MAX_DOUBLE, id << 1});
+                entry.max_at[axis] = (uint32_t)endpoints[axis].size();
+                endpoints[axis].push_back(Endpoint{MAX_DOUBLE, (id << 1) | 1});
+            }
+            boxes.push_back(entry);
+            // the new endpoints sit at the end of the axes, sorting them in finds the overlaps.
+            update(id, box);
+            return id;
+        }
+
+        id_type add( const Polygon_view& polygon ) { return add(polygon.bounds()); }
+
+        id_type add( const Polygon& polygon ) { return add(polygon.bounds()); }
+
+        // Call after the object moved (e.g. after self_translate / self_rotate).
+        // Cheap when the box moved a little: only the endpoints it passes are visited.
+        void update( id_type id, const AABB& box )
+        {
+            assert(id < boxes.size() && boxes[id].alive);
+            boxes[id].box = box;
+            for( int axis = 0; axis < 2; axis++ )
+            {
+                double lo = axis == 0 ? box.min.x : box.min.y;
+                double hi = axis == 0 ? box.max.x : box.max.y;
+                // Move the endpoint that goes outward first so the box never turns inside out while sorting.
+                if( lo < endpoints[axis][boxes[id].min_at[axis]].value )
+                {
+                    move(axis, boxes[id].min_at[axis], lo);
+                    move(axis, boxes[id].max_at[axis], hi);
+                }
+                else
+                {
+                    move(axis, boxes[id].max_at[axis], hi);
+                    move(axis, boxes[id].min_at[axis], lo);
+                }
+            }
+        }
+
+        void update( id_type id, const Polygon_view& polygon ) { update(id, polygon.bounds()); }
+
+        void update( id_type id, const Polygon& polygon ) { update(id, polygon.bounds()); }
+
+        // Removes a box. Its pairs are reported as removed. The id is not reused.
+        void remove( id_type id )
+        {
+            assert(id < boxes.size() && boxes[id].alive);
+            for( auto it = pairs.begin(); it != pairs.end(); )
+            {
+                Pair pair = unpack(*it);
+                if( pair.a == id || pair.b == id )
+                {
+                    record(removed_pairs, added_pairs, pair);
+                    it = pairs.erase(it);
+                }
+                else
+                    ++it;
+            }
+            boxes[id].alive = false;
+            for( int axis = 0; axis < 2; axis++ )
+            {
+                std::vector<Endpoint>& list = endpoints[axis];
+                uint32_t write = 0;
+                for( uint32_t read = 0; read < list.size(); read++ )
+                {
+                    if( (list[read].owner >> 1) == id ) continue;
+                    list[write] = list[read];
+                    set_index(axis, list[write], write);
+                    write++;
+                }
+                list.resize(write);
+            }
+        }
+
+        const AABB& box( id_type id ) const { return boxes[id].box; }
+
+        // number of ids handed out so far, including removed boxes
+        size_t size() const { return boxes.size(); }
+
+        // Pairs which started overlapping since the last clear_events().
+        // A pair which started and stopped overlapping in between is not reported at all.
+        const std::vector<Pair>& added() const { return added_pairs; }
+
+        // Pairs which stopped overlapping since the last clear_events().
+        const std::vector<Pair>& removed() const { return removed_pairs; }
+
+        void clear_events()
+        {
+            added_pairs.clear();
+            removed_pairs.clear();
+        }
+
+        bool overlapping( id_type a, id_type b ) const { return pairs.count(pack(a, b)) > 0; }
+
+        size_t pair_count() const { return pairs.size(); }
+
+        // Calls func(a, b) for every currently overlapping pair.
+        template <class Func>
+        void for_each_pair( Func func ) const
+        {
+            for( uint64_t key : pairs )
+            {
+                Pair pair = unpack(key);
+                func(pair.a, pair.b);
+            }
+        }
+
+    private:
+        struct Endpoint
+        {
+            double value;
+            uint32_t owner;     // id << 1 | is_max
+
+            bool is_max() const { return owner & 1; }
+
+            // mins go first on ties, so touching boxes count as overlapping like AABB::overlaps.
+            bool operator<( const Endpoint& other ) const
+            {
+                return value < other.value || (value == other.value && !is_max() && other.is_max());
+            }
+        };
+
+        struct Box
+        {
+            AABB box;
+            uint32_t min_at[2], max_at[2];  // position of the endpoints on each axis
+            bool alive;
+        };
+
+        std::vector<Endpoint> endpoints[2];
+        std::vector<Box> boxes;
+        std::unordered_set<uint64_t> pairs;
+        std::vector<Pair> added_pairs, removed_pairs;
+
+        static uint64_t pack( id_type a, id_type b )
+        {
+            if( a > b ) std::swap(a, b);
+            return (uint64_t(a) << 32) | b;
+        }
+
+        static Pair unpack( uint64_t key ) { return Pair{id_type(key >> 32), id_type(key & 0xffffffff)}; }
+
+        void set_index( int axis, const Endpoint& e, uint32_t index )
+        {
+            Box& owner = boxes[e.owner >> 1];
+            if( e.is_max() ) owner.max_at[axis] = index;
+            else owner.min_at[axis] = index;
+        }
+
+        // Records an event, unless it cancels an opposite event since the last clear_events().
+        static void record( std::vector<Pair>& events, std::vector<Pair>& opposite, const Pair& pair )
+        {
+            for( size_t i = 0; i < opposite.size(); i++ )
+            {
+                if( opposite[i] == pair )
+                {
+                    opposite[i] = opposite.back();
+                    opposite.pop_back();
+                    return;
+                }
+            }
+            events.push_back(pair);
+        }
+
+        void begin_overlap( id_type a, id_type b )
+        {
+            if( !boxes[a].box.overlaps(boxes[b].box) ) return;
+            if( pairs.insert(pack(a, b)).second )
+                record(added_pairs, removed_pairs, unpack(pack(a, b)));
+        }
+
+        void end_overlap( id_type a, id_type b )
+        {
+            if( pairs.erase(pack(a, b)) )
+                record(removed_pairs, added_pairs, unpack(pack(a, b)));
+        }
+
+        // Insertion sort of one endpoint to its new value.
+        void move( int axis, uint32_t index, double value )
+        {
+            std::vector<Endpoint>& list = endpoints[axis];
+            Endpoint e = list[index];
+            e.value = value;
+            id_type id = e.owner >> 1;
+
+            while( index > 0 && e < list[index - 1] )
+            {
+                const Endpoint& prev = list[index - 1];
+                id_type other = prev.owner >> 1;
+                // a min passing a max to the left: they may start overlapping
+                if( !e.is_max() && prev.is_max() ) begin_overlap(id, other);
+                // a max passing a min to the left: they stop overlapping
+                else if( e.is_max() && !prev.is_max() ) end_overlap(id, other);
+                list[index] = prev;
+                set_index(axis, prev, index);
+                index--;
+            }
+            while( index + 1 < list.size() && list[index + 1] < e )
+            {
+                const Endpoint& next = list[index + 1];
+                id_type other = next.owner >> 1;
+                // a max passing a min to the right: they may start overlapping
+                if( e.is_max() && !next.is_max() ) begin_overlap(id, other);
+                // a min passing a max to the right: they stop overlapping
+                else if( !e.is_max() && next.is_max() ) end_overlap(id, other);
+                list[index] = next;
+                set_index(axis, next, index);
+                index++;
+            }
+            list[index] = e;
+            set_index(axis, e, index);
+        }
+    };
+}
+
+#endif
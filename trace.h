@@ -0,0 +1,257 @@
+//
+//  trace.h
+//  Naive2D
+//
+//  Scoped timing spans that can be opened in chrome://tracing or Perfetto
+//  (https://ui.perfetto.dev), to see which stage of a planning iteration or
+//  a rendered frame the time goes to.
+//
+//      N2D_TRACE_SPAN("plan::expand");     // times the rest of the scope
+//      ...
+//      N2D::trace::save("trace.json");
+//
+//  Spans are only recorded if N2D_ENABLE_TRACE is defined before the first
+//  Naive2D header is included (e.g. -DN2D_ENABLE_TRACE); otherwise the macro
+//  expands to nothing and costs nothing. Every thread writes to its own ring
+//  buffer of N2D_TRACE_CAPACITY spans, so recording takes no lock, and once
+//  a buffer is full the oldest spans are overwritten. Buffers of threads that
+//  exited are reused by new threads, so the spans of short-lived threads that
+//  ran one after another share a track (tid) in the trace.
+//
+//  Reference:
+//      Trace Event Format.
+//      https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+//
+
+#ifndef Naive2D_trace_h
+#define Naive2D_trace_h
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifndef N2D_TRACE_CAPACITY
+#define N2D_TRACE_CAPACITY (1 << 16)
+#endif
+
+namespace N2D {
+    namespace trace
+    {
+        // spans kept per thread, a power of two
+        constexpr uint64_t CAPACITY = N2D_TRACE_CAPACITY;
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "N2D_TRACE_CAPACITY has to be a power of two");
+
+        struct Event
+        {
+            const char* name;       // a string literal, only the pointer is stored
+            int64_t start;          // ns on the steady clock
+            int64_t duration;       // ns
+        };
+
+        /* One span in a ring buffer. `sequence` is n + 1 while the slot holds span n, and BUSY while the
+         * owner rewrites it, so a reader can tell a torn or overwritten copy from the span it asked for
+         * (a seqlock with a single writer). The fields are relaxed atomics, so copying them races with nothing.
+         */
+        struct Slot
+        {
+            static constexpr uint64_t BUSY = ~uint64_t(0);
+
+            std::atomic<uint64_t> sequence{0};
+            std::atomic<const char*> name{nullptr};
+            std::atomic<int64_t> start{0};
+            std::atomic<int64_t> duration{0};
+        };
+
+        /* One thread's spans. Only the owning thread writes the slots and `written`, which counts every
+         * span ever recorded. Readers only see the spans from `first` on, so clearing never touches `written`.
+         */
+        struct Buffer
+        {
+            std::vector<Slot> slots;
+            std::atomic<uint64_t> written{0};
+            std::atomic<uint64_t> first{0};
+            uint32_t thread;
+
+            explicit Buffer( uint32_t thread ) : slots(CAPACITY), thread(thread) {}
+
+            void record( const char* name, int64_t start, int64_t duration )
+            {
+                uint64_t n = written.load(std::memory_order_relaxed);
+                Slot& slot = slots[n & (CAPACITY - 1)];
+                slot.sequence.store(Slot::BUSY, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.name.store(name, std::memory_order_relaxed);
+                slot.start.store(start, std::memory_order_relaxed);
+                slot.duration.store(duration, std::memory_order_relaxed);
+                slot.sequence.store(n + 1, std::memory_order_release);
+                written.store(n + 1, std::memory_order_release);
+            }
+
+            // Copies span n into e. Returns false if the slot no longer holds it or is being rewritten.
+            bool read( uint64_t n, Event& e ) const
+            {
+                const Slot& slot = slots[n & (CAPACITY - 1)];
+                if( slot.sequence.load(std::memory_order_acquire) != n + 1 ) return false;
+                e.name = slot.name.load(std::memory_order_relaxed);
+                e.start = slot.start.load(std::memory_order_relaxed);
+                e.duration = slot.duration.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return slot.sequence.load(std::memory_order_relaxed) == n + 1;
+            }
+        };
+
+        inline int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /* The buffers of every thread that recorded a span; they outlive their threads so they can still be saved.
+         * A thread that exits puts its buffer in `idle`, and the next new thread records into it after the old
+         * spans, so there are never more buffers than threads alive at once.
+         */
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Buffer>> buffers;
+            std::vector<Buffer*> idle;
+            int64_t origin = now();     // exported times are relative to this
+        };
+
+        inline Registry& registry()
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        // A thread's buffer, handed back to the registry when the thread exits.
+        class Buffer_lease
+        {
+        public:
+            Buffer_lease()
+            {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                if( r.idle.empty() )
+                {
+                    r.buffers.push_back(std::unique_ptr<Buffer>(new Buffer((uint32_t)r.buffers.size())));
+                    buffer = r.buffers.back().get();
+                }
+                else
+                {
+                    buffer = r.idle.back();
+                    r.idle.pop_back();
+                }
+            }
+
+            ~Buffer_lease()
+            {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.idle.push_back(buffer);
+            }
+
+            Buffer_lease( const Buffer_lease& ) = delete;
+            Buffer_lease& operator=( const Buffer_lease& ) = delete;
+
+            Buffer* buffer;
+        };
+
+        inline Buffer& local_buffer()
+        {
+            thread_local Buffer_lease lease;
+            return *lease.buffer;
+        }
+
+        // Records the time from its construction to the end of the scope.
+        class Span
+        {
+        public:
+            explicit Span( const char* name ) : buffer(local_buffer()), name(name), start(now()) {}
+            ~Span() { buffer.record(name, start, now() - start); }
+            Span( const Span& ) = delete;
+            Span& operator=( const Span& ) = delete;
+        private:
+            Buffer& buffer;
+            const char* name;
+            int64_t start;
+        };
+
+        /* Calls f(thread, event) for every span still in the buffers, oldest first per thread.
+         * Spans a thread overwrites while they are being read are skipped.
+         */
+        template <class Visit>
+        static inline void for_each( const Visit& f )
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for( const auto& buffer : r.buffers )
+            {
+                uint64_t written = buffer->written.load(std::memory_order_acquire);
+                uint64_t first = std::max(buffer->first.load(std::memory_order_relaxed), written > CAPACITY ? written - CAPACITY : 0);
+                Event e;
+                for( uint64_t i = first; i < written; i++ )
+                    if( buffer->read(i, e) ) f(buffer->thread, e);
+            }
+        }
+
+        // Number of spans currently held.
+        static inline size_t size()
+        {
+            size_t n = 0;
+            for_each([&](uint32_t, const Event&){ n++; });
+            return n;
+        }
+
+        // Drops every span recorded so far. Only the readers' start index moves; the owners keep counting.
+        static inline void clear()
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for( const auto& buffer : r.buffers )
+                buffer->first.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+
+        // Writes the spans in the Chrome trace event format, one complete ("X") event per span.
+        static inline void write_json( std::ostream& out )
+        {
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            bool first = true;
+            char times[64];
+            int64_t origin = registry().origin;
+            for_each([&](uint32_t thread, const Event& e){
+                // timestamps are in microseconds
+                snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", (e.start - origin) / 1000.0, e.duration / 1000.0);
+                // names are identifiers like "GJK::distance", quotes and backslashes are not escaped
+                out << (first ? "\n" : ",\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << "," << times << "}";
+                first = false;
+            });
+            out << "\n]}\n";
+        }
+
+        static inline void save( const char* filename )
+        {
+            std::ofstream file(filename);
+            if( !file )
+                throw "Cannot open the trace file.";
+            write_json(file);
+        }
+    }
+}
+
+#define N2D_TRACE_CONCAT_(a, b) a##b
+#define N2D_TRACE_CONCAT(a, b) N2D_TRACE_CONCAT_(a, b)
+
+#ifdef N2D_ENABLE_TRACE
+#define N2D_TRACE_SPAN(name) N2D::trace::Span N2D_TRACE_CONCAT(n2d_trace_span_, __LINE__)(name)
+#else
+#define N2D_TRACE_SPAN(name) do {} while(0)
+#endif
+
+#endif
@@ -0,0 +1,558 @@
+//
+//  visibility_graph.h
+//  Naive2D
+//
+//  Visibility graph over the vertices of polygonal obstacles, for shortest
+//  path planning. Instead of testing every vertex pair against every edge,
+//  each vertex sweeps a ray once around itself (Lee's rotational plane
+//  sweep) and keeps the obstacle edges the ray crosses in a balanced tree
+//  ordered by distance, so only the nearest edge has to be tested. That is
+//  O(n log n) per vertex, O(n^2 log n) in total, and the vertices are swept
+//  in parallel. Segments may touch obstacle boundaries but never pass through
+//  an obstacle's interior. All orientation tests are exact.
+//
+//  Reference:
+//      M. de Berg et al., Computational Geometry: Algorithms and Applications,
+//      3rd ed., chapter 15.2.
+//
+
+#ifndef Naive2D_visibility_graph_h
+#define Naive2D_visibility_graph_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "geometry.h"
+#include "polygon.h"
+
+namespace N2D {
+
+    /* Minkowski sum of a convex polygon and a disk, i.e. the obstacle as seen by the center of a
+     * round robot. The rounded corners are replaced by segments tangent to the disk, so the
+     * result contains the exact sum. Keeps the winding order of the input.
+     * @param max_angle: the largest turn (radians) one corner segment may cover
+     */
+    static inline Polygon inflate( const Polygon_view& convex, double radius, double max_angle = PI / 8 )
+    {
+        unsigned n = convex.size;
+        double area = 0.0;
+        for(unsigned i = 0; i < n; i++)
+            area += convex[i].cross(convex[(i + 1) % n]);
+        double orientation = area > 0 ? 1.0 : -1.0;
+
+        auto normal = [&](unsigned i) {
+            v2 edge = convex[(i + 1) % n] - convex[i];
+            return v2(edge.y, -edge.x).norm() * orientation;
+        };
+
+        std::vector<v2> points;
+        points.reserve(2 * n);
+        for(unsigned i = 0; i < n; i++)
+        {
+            v2 from = normal((i + n - 1) % n), to = normal(i);
+            double angle = std::atan2(std::fabs(from.cross(to)), from.dot(to));
+            int steps = std::max(1, (int)std::ceil(angle / max_angle));
+            double step = angle / steps;
+            // corner j is where the tangents at the start and the end of step j meet
+            double distance = radius / std::cos(step / 2);
+            for(int j = 0; j < steps; j++)
+            {
+                double theta = orientation * (j + 0.5) * step;
+                v2 dir(from.x * std::cos(theta) - from.y * std::sin(theta), from.x * std::sin(theta) + from.y * std::cos(theta));
+                points.push_back(convex[i] + dir * distance);
+            }
+        }
+        return Polygon(std::move(points));
+    }
+
+    /* Visibility graph in compressed sparse row form: the vertices visible from vertex i are
+     * neighbors[offsets[i]] .. neighbors[offsets[i+1] - 1]. Every edge is stored in both directions.
+     * Vertices are numbered polygon after polygon in the order of the obstacles.
+     */
+    class Visibility_graph
+    {
+    public:
+        std::vector<v2> vertices;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> neighbors;
+
+        /* @param obstacles: simple polygons, in either winding order; they may overlap
+         * @param robot_radius: if positive, the obstacles have to be convex and are inflated by the
+         *                      radius first, so the graph is the one a round robot's center moves on
+         */
+        explicit Visibility_graph( const std::vector<Polygon>& obstacles, double robot_radius = 0.0 )
+        {
+            for( const Polygon& obstacle : obstacles )
+            {
+                if( robot_radius > 0.0 )
+                    add_polygon(inflate(obstacle.view(), robot_radius).view());
+                else
+                    add_polygon(obstacle.view());
+            }
+            mark_buried();
+            find_contacts();
+            split_edges();
+
+            int n = (int)vertices.size();
+            std::vector<std::vector<uint32_t>> lists(n);
+            #pragma omp parallel
+            {
+                std::vector<uint32_t> order;
+                #pragma omp for schedule(dynamic, 16)
+                for( int i = 0; i < n; i++ )
+                    if( !buried[i] ) sweep(vertices[i], &contacts[contact_offsets[i]], &contacts[contact_offsets[i + 1]], lists[i], order);
+            }
+
+            offsets.resize(n + 1);
+            offsets[0] = 0;
+            for( int i = 0; i < n; i++ )
+                offsets[i + 1] = offsets[i] + (uint32_t)lists[i].size();
+            neighbors.resize(offsets[n]);
+            for( int i = 0; i < n; i++ )
+                std::copy(lists[i].begin(), lists[i].end(), neighbors.begin() + offsets[i]);
+        }
+
+        size_t size() const { return vertices.size(); }
+
+        size_t edge_count() const { return neighbors.size() / 2; }
+
+        unsigned degree( uint32_t i ) const { return offsets[i + 1] - offsets[i]; }
+
+        const uint32_t* begin( uint32_t i ) const { return neighbors.data() + offsets[i]; }
+        const uint32_t* end( uint32_t i ) const { return neighbors.data() + offsets[i + 1]; }
+
+        /* The graph vertices visible from an arbitrary point, e.g. the start or the goal of a query.
+         * Nothing is visible from inside an obstacle.
+         */
+        std::vector<uint32_t> visible_from( const v2& point ) const
+        {
+            std::vector<uint32_t> visible, order, at;
+            for( size_t k = 0; k < polygon_start.size(); k++ )
+            {
+                Polygon_view polygon(vertices.data() + polygon_start[k], polygon_size(k));
+                if( polygon.contains(point) && polygon.penetration(point) > 0.0 )
+                    return visible;
+            }
+            // the boundary features the point lies on
+            for( uint32_t i = 0; i < (uint32_t)vertices.size(); i++ )
+            {
+                const v2& a = vertices[i]; const v2& b = vertices[next[i]];
+                if( a == point )
+                    at.push_back(i);
+                else if( b != point && orient(a, b, point) == 0.0 && predicates::in_box(a.x, a.y, b.x, b.y, point.x, point.y) )
+                    at.push_back(i | EDGE);
+            }
+            sweep(point, at.data(), at.data() + at.size(), visible, order);
+            return visible;
+        }
+
+    private:
+        struct Segment { uint32_t a, b, edge; };    // a piece of obstacle edge `edge`, in the same direction
+
+        // Per vertex: its polygon and its neighbours on it.
+        std::vector<uint32_t> polygon_of, prev, next;
+        std::vector<uint32_t> polygon_start;
+        std::vector<double> orientation;    // per polygon, +1 counterclockwise, -1 clockwise
+        std::vector<char> buried;           // strictly inside another obstacle, never visible
+
+        // The boundary features at vertex i, contacts[contact_offsets[i]] .. contacts[contact_offsets[i+1] - 1]:
+        // every vertex at the same position (i included), and every edge e passing through it as e | EDGE.
+        static constexpr uint32_t EDGE = 0x80000000u;
+        std::vector<uint32_t> contact_offsets, contacts;
+
+        // The obstacle edges cut where edges of different obstacles cross, so that no two segments
+        // cross. points are the vertices followed by the crossings; the segments at point i are
+        // incident[incident_offsets[i]] .. incident[incident_offsets[i+1] - 1].
+        std::vector<v2> points;
+        std::vector<Segment> segments;
+        std::vector<uint32_t> incident_offsets, incident;
+
+        unsigned polygon_size( size_t k ) const
+        {
+            size_t end = k + 1 < polygon_start.size() ? polygon_start[k + 1] : vertices.size();
+            return (unsigned)(end - polygon_start[k]);
+        }
+
+        void add_polygon( const Polygon_view& polygon )
+        {
+            uint32_t first = (uint32_t)vertices.size();
+            uint32_t id = (uint32_t)polygon_start.size();
+            double area = 0.0;
+            for(unsigned i = 0; i < polygon.size; i++)
+            {
+                area += polygon[i].cross(polygon[(i + 1) % polygon.size]);
+                vertices.push_back(polygon[i]);
+                polygon_of.push_back(id);
+                prev.push_back(first + (i + polygon.size - 1) % polygon.size);
+                next.push_back(first + (i + 1) % polygon.size);
+            }
+            polygon_start.push_back(first);
+            orientation.push_back(area > 0 ? 1.0 : -1.0);
+        }
+
+        void mark_buried()
+        {
+            size_t count = polygon_start.size();
+            std::vector<AABB> bounds(count);
+            for( size_t k = 0; k < count; k++ )
+                bounds[k] = Polygon_view(vertices.data() + polygon_start[k], polygon_size(k)).bounds();
+            buried.assign(vertices.size(), 0);
+            int n = (int)vertices.size();
+            #pragma omp parallel for schedule(static)
+            for( int i = 0; i < n; i++ )
+            {
+                for( size_t k = 0; k < count; k++ )
+                {
+                    if( k == polygon_of[i] || !bounds[k].contains(vertices[i]) ) continue;
+                    Polygon_view polygon(vertices.data() + polygon_start[k], polygon_size(k));
+                    if( polygon.contains(vertices[i]) && polygon.penetration(vertices[i]) > 0.0 )
+                    {
+                        buried[i] = 1;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Where obstacles touch: vertices at the same position, and vertices on another obstacle's edge.
+        void find_contacts()
+        {
+            uint32_t n = (uint32_t)vertices.size();
+            std::vector<uint32_t> by_x(n);
+            for( uint32_t i = 0; i < n; i++ ) by_x[i] = i;
+            auto less = [&](uint32_t a, uint32_t b){ return vertices[a].x < vertices[b].x || (vertices[a].x == vertices[b].x && vertices[a].y < vertices[b].y); };
+            std::sort(by_x.begin(), by_x.end(), less);
+
+            std::vector<std::vector<uint32_t>> lists(n);
+            for( uint32_t i = 0; i < n; )
+            {
+                uint32_t j = i;
+                while( j < n && vertices[by_x[j]] == vertices[by_x[i]] ) j++;
+                for( uint32_t a = i; a < j; a++ )
+                    for( uint32_t b = i; b < j; b++ )
+                        lists[by_x[a]].push_back(by_x[b]);
+                i = j;
+            }
+            for( uint32_t e = 0; e < n; e++ )
+            {
+                const v2& a = vertices[e]; const v2& b = vertices[next[e]];
+                auto first = std::lower_bound(by_x.begin(), by_x.end(), std::min(a.x, b.x), [&](uint32_t v, double x){ return vertices[v].x < x; });
+                for( auto it = first; it != by_x.end() && vertices[*it].x <= std::max(a.x, b.x); ++it )
+                {
+                    const v2& p = vertices[*it];
+                    if( p == a || p == b || !predicates::in_box(a.x, a.y, b.x, b.y, p.x, p.y) || orient(a, b, p) != 0.0 ) continue;
+                    lists[*it].push_back(e | EDGE);
+                }
+            }
+
+            contact_offsets.assign(n + 1, 0);
+            for( uint32_t i = 0; i < n; i++ )
+                contact_offsets[i + 1] = contact_offsets[i] + (uint32_t)lists[i].size();
+            contacts.resize(contact_offsets[n]);
+            for( uint32_t i = 0; i < n; i++ )
+                std::copy(lists[i].begin(), lists[i].end(), contacts.begin() + contact_offsets[i]);
+        }
+
+        // Finds the crossings of overlapping obstacles (sort and sweep on x) and builds the segments.
+        void split_edges()
+        {
+            uint32_t n = (uint32_t)vertices.size();
+            points = vertices;
+            std::vector<AABB> bounds(n);
+            std::vector<uint32_t> by_x(n);
+            for( uint32_t e = 0; e < n; e++ )
+            {
+                bounds[e].expand(vertices[e]);
+                bounds[e].expand(vertices[next[e]]);
+                by_x[e] = e;
+            }
+            std::sort(by_x.begin(), by_x.end(), [&](uint32_t a, uint32_t b){ return bounds[a].min.x < bounds[b].min.x; });
+
+            // (position along the edge, crossing point) per edge
+            std::vector<std::vector<std::pair<double, uint32_t>>> cuts(n);
+            for( uint32_t i = 0; i < n; i++ )
+            {
+                uint32_t e = by_x[i];
+                const v2& a = vertices[e]; const v2& b = vertices[next[e]];
+                for( uint32_t j = i + 1; j < n && bounds[by_x[j]].min.x <= bounds[e].max.x; j++ )
+                {
+                    uint32_t f = by_x[j];
+                    if( polygon_of[e] == polygon_of[f] || !bounds[e].overlaps(bounds[f]) ) continue;
+                    const v2& c = vertices[f]; const v2& d = vertices[next[f]];
+                    if( !crosses(a, b, c, d) ) continue;
+                    double oa = orient(c, d, a), oc = orient(a, b, c);
+                    double s = oa / (oa - orient(c, d, b));
+                    double t = oc / (oc - orient(a, b, d));
+                    uint32_t id = (uint32_t)points.size();
+                    points.push_back(a + (b - a) * s);
+                    cuts[e].emplace_back(s, id);
+                    cuts[f].emplace_back(t, id);
+                }
+            }
+
+            for( uint32_t e = 0; e < n; e++ )
+            {
+                std::sort(cuts[e].begin(), cuts[e].end());
+                uint32_t from = e;
+                for( const auto& cut : cuts[e] )
+                {
+                    if( points[cut.second] == points[from] ) continue;
+                    segments.push_back(Segment{from, cut.second, e});
+                    from = cut.second;
+                }
+                if( points[from] != points[next[e]] )
+                    segments.push_back(Segment{from, next[e], e});
+            }
+
+            incident_offsets.assign(points.size() + 1, 0);
+            for( const Segment& s : segments )
+            {
+                incident_offsets[s.a + 1]++;
+                incident_offsets[s.b + 1]++;
+            }
+            for( size_t i = 0; i < points.size(); i++ )
+                incident_offsets[i + 1] += incident_offsets[i];
+            incident.resize(incident_offsets.back());
+            std::vector<uint32_t> fill(incident_offsets.begin(), incident_offsets.end() - 1);
+            for( uint32_t k = 0; k < (uint32_t)segments.size(); k++ )
+            {
+                incident[fill[segments[k].a]++] = k;
+                incident[fill[segments[k].b]++] = k;
+            }
+        }
+
+        static double orient( const v2& a, const v2& b, const v2& c )
+        {
+            return predicates::orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+        }
+
+        // segments a-b and c-d cross at a single point inside both of them
+        static bool crosses( const v2& a, const v2& b, const v2& c, const v2& d )
+        {
+            double o1 = orient(a, b, c), o2 = orient(a, b, d);
+            if( o1 == 0.0 || o2 == 0.0 || (o1 > 0.0) == (o2 > 0.0) ) return false;
+            double o3 = orient(c, d, a), o4 = orient(c, d, b);
+            return o3 != 0.0 && o4 != 0.0 && (o3 > 0.0) != (o4 > 0.0);
+        }
+
+        // whether the direction from vertex v to q points strictly into the interior of v's polygon
+        bool interior_at_vertex( uint32_t v, const v2& q ) const
+        {
+            const v2& c = vertices[v];
+            if( q == c ) return false;
+            const v2* a = &vertices[prev[v]];
+            const v2* b = &vertices[next[v]];
+            if( orientation[polygon_of[v]] < 0 ) std::swap(a, b);
+            // counterclockwise, the interior at c turns from the direction of b to the direction of a
+            double turn = orient(*a, c, *b);
+            double o1 = orient(c, *b, q), o2 = orient(c, q, *a);
+            if( turn > 0.0 ) return o1 > 0.0 && o2 > 0.0;
+            if( turn < 0.0 ) return o1 > 0.0 || o2 > 0.0;
+            return o1 > 0.0;
+        }
+
+        // whether the direction to q from a point on the inside of edge e points into e's polygon
+        bool interior_at_edge( uint32_t e, const v2& q ) const
+        {
+            return orientation[polygon_of[e]] * orient(vertices[e], vertices[next[e]], q) > 0.0;
+        }
+
+        // whether a segment leaving a point with the given boundary features towards q enters an obstacle
+        bool enters( const uint32_t* first, const uint32_t* last, const v2& q ) const
+        {
+            for( ; first != last; ++first )
+                if( *first & EDGE ? interior_at_edge(*first & ~EDGE, q) : interior_at_vertex(*first, q) )
+                    return true;
+            return false;
+        }
+
+        bool enters( uint32_t v, const v2& q ) const { return enters(&contacts[contact_offsets[v]], &contacts[contact_offsets[v + 1]], q); }
+
+        /* Whether the center sees the outside of segment s. A ray leaving the center through free
+         * space enters an obstacle before it can leave one, so the first segment it hits always
+         * faces the center and the others never have to be in the sweep.
+         */
+        bool faces( uint32_t s, const v2& center ) const
+        {
+            uint32_t e = segments[s].edge;
+            return orientation[polygon_of[e]] * orient(vertices[e], vertices[next[e]], center) < 0.0;
+        }
+
+        /* Orders the segments crossed by a ray from the sweep center by their distance along it.
+         * Segments do not cross each other, so the order is the same for every ray that crosses
+         * both of them and does not depend on the current angle of the sweep.
+         */
+        struct Segment_order
+        {
+            const Visibility_graph* graph;
+            v2 center;
+
+            bool operator()( uint32_t a, uint32_t b ) const
+            {
+                if( a == b ) return false;
+                const v2& a1 = graph->points[graph->segments[a].a]; const v2& a2 = graph->points[graph->segments[a].b];
+                const v2& b1 = graph->points[graph->segments[b].a]; const v2& b2 = graph->points[graph->segments[b].b];
+                int s1 = predicates::sign(orient(b1, b2, a1)), s2 = predicates::sign(orient(b1, b2, a2));
+                // a lies on one side of the line of b: a is in front if it is on the center's side
+                if( s1 * s2 >= 0 && (s1 | s2) )
+                    return (s1 ? s1 : s2) == predicates::sign(orient(b1, b2, center));
+                int t1 = predicates::sign(orient(a1, a2, b1)), t2 = predicates::sign(orient(a1, a2, b2));
+                if( t1 * t2 >= 0 && (t1 | t2) )
+                    return (t1 ? t1 : t2) != predicates::sign(orient(a1, a2, center));
+                return a < b;
+            }
+        };
+
+        // Counterclockwise angle order around the center starting at the +x axis; nearer first on ties.
+        static bool angle_less( const v2& center, const v2& a, const v2& b )
+        {
+            bool a_lower = a.y < center.y || (a.y == center.y && a.x < center.x);
+            bool b_lower = b.y < center.y || (b.y == center.y && b.x < center.x);
+            if( a_lower != b_lower ) return b_lower;
+            double o = orient(center, a, b);
+            if( o != 0.0 ) return o > 0.0;
+            return a != b && predicates::in_box(center.x, center.y, b.x, b.y, a.x, a.y);
+        }
+
+        // a monotone stand in for the angle of (dx, dy) in [0, 4), cheap to sort by
+        static double pseudo_angle( double dx, double dy )
+        {
+            if( dy >= 0.0 )
+                return dx >= 0.0 ? (dx + dy > 0.0 ? dy / (dx + dy) : 0.0) : 1.0 - dx / (dy - dx);
+            return dx < 0.0 ? 2.0 - dy / (-dx - dy) : 3.0 + dx / (dx - dy);
+        }
+
+        /* Moves the sweep past the points first .. last, which share a position: segments ending
+         * there leave the ray, then segments starting there enter it. A segment that ends and one
+         * that starts at the same point never cross the same ray, so they must not be in the set together.
+         */
+        template <class Set>
+        void advance( const v2& center, const uint32_t* first, const uint32_t* last, Set& active ) const
+        {
+            const v2& point = points[*first];
+            for( int pass = 0; pass < 2; pass++ )
+            {
+                for( const uint32_t* w = first; w != last; ++w )
+                {
+                    for( uint32_t k = incident_offsets[*w]; k < incident_offsets[*w + 1]; k++ )
+                    {
+                        const Segment& s = segments[incident[k]];
+                        if( !faces(incident[k], center) ) continue;
+                        const v2& other = points[s.a == *w ? s.b : s.a];
+                        if( other == center ) continue;
+                        double side = orient(center, point, other);
+                        if( pass == 0 && side < 0.0 ) active.erase(incident[k]);
+                        if( pass == 1 && side > 0.0 ) active.insert(incident[k]);
+                    }
+                }
+            }
+        }
+
+        /* Appends the vertices visible from `center` to `visible`.
+         * @param at, at_end: the boundary features center lies on, in the form of contacts
+         * @param order: scratch space
+         */
+        void sweep( const v2& center, const uint32_t* at, const uint32_t* at_end, std::vector<uint32_t>& visible, std::vector<uint32_t>& order ) const
+        {
+            uint32_t n = (uint32_t)points.size();
+            uint32_t vertex_count = (uint32_t)vertices.size();
+
+            // sort by a floating point angle, then repair the few pairs it got wrong with the exact order
+            struct Key { double angle, distance; uint32_t index; };
+            std::vector<Key> keys;
+            keys.reserve(n);
+            for( uint32_t i = 0; i < n; i++ )
+            {
+                if( points[i] == center ) continue;
+                v2 d = points[i] - center;
+                keys.push_back(Key{pseudo_angle(d.x, d.y), d.rsq(), i});
+            }
+            std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b){ return a.angle < b.angle || (a.angle == b.angle && a.distance < b.distance); });
+            order.resize(keys.size());
+            for( size_t k = 0; k < keys.size(); k++ )
+            {
+                uint32_t index = keys[k].index;
+                size_t j = k;
+                for( ; j > 0 && angle_less(center, points[index], points[order[j - 1]]); j-- )
+                    order[j] = order[j - 1];
+                order[j] = index;
+            }
+
+            // segments facing the center that are crossed by the ray just below the +x axis
+            std::set<uint32_t, Segment_order> active(Segment_order{this, center});
+            for( uint32_t s = 0; s < (uint32_t)segments.size(); s++ )
+            {
+                const v2& u = points[segments[s].a]; const v2& v = points[segments[s].b];
+                if( u == center || v == center ) continue;
+                bool crossed;
+                if( (u.y < center.y) && (v.y > center.y) )       crossed = orient(u, v, center) > 0.0;
+                else if( (v.y < center.y) && (u.y > center.y) )  crossed = orient(v, u, center) > 0.0;
+                else if( u.y < center.y && v.y == center.y )     crossed = v.x > center.x;
+                else if( v.y < center.y && u.y == center.y )     crossed = u.x > center.x;
+                else crossed = false;
+                if( crossed && faces(s, center) ) active.insert(s);
+            }
+
+            // Several points can share a position (e.g. a vertex on another obstacle's edge); they
+            // are seen through the previous position, and a line passes a position only if it
+            // passes every point there.
+            size_t group_begin = 0;                     // first point at the current position
+            size_t behind_begin = 0, behind_end = 0;    // the points at the previous position
+            bool group_passable = true, behind_passable = false;
+            for( size_t k = 0; k < order.size(); k++ )
+            {
+                uint32_t w = order[k];
+                const v2& point = points[w];
+                if( k > 0 && points[order[k - 1]] != point )
+                {
+                    advance(center, order.data() + group_begin, order.data() + k, active);
+                    behind_begin = group_begin;
+                    behind_end = k;
+                    behind_passable = group_passable;
+                    group_begin = k;
+                    group_passable = true;
+                }
+                // crossings are never visible: every line through one enters an obstacle
+                bool seen = false;
+                if( w < vertex_count && !buried[w] && !enters(at, at_end, point) && !enters(w, center) )
+                {
+                    const v2& behind = points[order[behind_begin]];
+                    bool collinear = behind_end > 0 && orient(center, point, behind) == 0.0 &&
+                                     predicates::in_box(center.x, center.y, point.x, point.y, behind.x, behind.y);
+                    if( !collinear )
+                    {
+                        // only the nearest crossed segment can hide w
+                        if( active.empty() )
+                            seen = true;
+                        else
+                        {
+                            const Segment& s = segments[*active.begin()];
+                            seen = !crosses(center, point, points[s.a], points[s.b]);
+                        }
+                    }
+                    else if( behind_passable )
+                    {
+                        // w is seen through the previous position: only the segments between the two can hide it
+                        seen = true;
+                        for( size_t m = behind_begin; m < behind_end && seen; m++ )
+                            seen = !enters(order[m], point);
+                        for( uint32_t e : active )
+                        {
+                            if( !seen ) break;
+                            const v2& e1 = points[segments[e].a]; const v2& e2 = points[segments[e].b];
+                            if( !predicates::segments_intersect(center.x, center.y, point.x, point.y, e1.x, e1.y, e2.x, e2.y) ) break;
+                            seen = !crosses(behind, point, e1, e2);
+                        }
+                    }
+                }
+                if( seen ) visible.push_back(w);
+                group_passable = group_passable && seen;
+            }
+        }
+    };
+}
+
+#endif